@@ -0,0 +1,105 @@
+#include "Suite.h"
+#include "../ex01/colors.h"
+
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <sstream>
+
+Suite::Suite(const double thresholdPercent) : thresholdPercent_(thresholdPercent) {
+}
+
+Suite::Suite(const Suite &other) : thresholdPercent_(other.thresholdPercent_), metrics_(other.metrics_) {
+}
+
+Suite &Suite::operator=(const Suite &other) {
+    if (this != &other) {
+        thresholdPercent_ = other.thresholdPercent_;
+        metrics_ = other.metrics_;
+    }
+    return *this;
+}
+
+Suite::~Suite() = default;
+
+// Missing files yield an empty baseline.
+static std::map<std::string, double> readBaseline(const std::string &path) {
+    std::map<std::string, double> baseline;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream fields(line);
+        std::string name;
+        double value;
+        if (fields >> name >> value) baseline[name] = value;
+    }
+    return baseline;
+}
+
+static bool writeBaseline(const std::string &path, const std::vector<Metric> &metrics, const bool exact,
+                          std::ostream &out) {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        out << RED << "Error: " << RESET << "could not write baseline " << path << std::endl;
+        return false;
+    }
+    file << "# name value unit\n" << std::setprecision(17);
+    for (const Metric &m: metrics) {
+        if (m.exact == exact) file << m.name << ' ' << m.value << ' ' << m.unit << '\n';
+    }
+    out << YELLOW << "Baseline written to " << RESET << path << std::endl;
+    return true;
+}
+
+void Suite::count(const std::string &name, const double value, const std::string &unit) {
+    metrics_.push_back(Metric{name, value, unit, true});
+}
+
+bool Suite::check(const std::string &countsPath, const std::string &timingsPath, const bool update,
+                  std::ostream &out) const {
+    const bool haveCounts = !update && std::ifstream(countsPath).is_open();
+    const bool haveTimings = !update && std::ifstream(timingsPath).is_open();
+    std::map<std::string, double> counts;
+    std::map<std::string, double> timings;
+    if (haveCounts) counts = readBaseline(countsPath);
+    if (haveTimings) timings = readBaseline(timingsPath);
+
+    bool ok = true;
+    out << std::left << std::setw(32) << "metric" << std::right << std::setw(14) << "value"
+            << std::setw(14) << "baseline" << std::setw(10) << "change" << "  unit" << std::endl;
+    for (const Metric &m: metrics_) {
+        out << std::left << std::setw(32) << m.name << std::right << std::fixed << std::setprecision(2)
+                << std::setw(14) << m.value;
+
+        const std::map<std::string, double> &baseline = m.exact ? counts : timings;
+        const std::map<std::string, double>::const_iterator it = baseline.find(m.name);
+        if (it == baseline.end()) {
+            out << std::setw(14) << "-" << std::setw(10) << "new" << "  " << m.unit << std::endl;
+            continue;
+        }
+        const double change = it->second > 0 ? (m.value - it->second) / it->second * 100.0 : 0.0;
+        const bool regressed = m.exact ? m.value > it->second : change > thresholdPercent_;
+        out << std::setw(14) << it->second << std::setw(9) << std::showpos << change << std::noshowpos << '%'
+                << "  " << m.unit;
+        if (regressed) {
+            out << "  " << RED << "REGRESSED" << RESET;
+            ok = false;
+        }
+        out << std::endl;
+    }
+    out.unsetf(std::ios::floatfield);
+
+    if (update) {
+        return writeBaseline(countsPath, metrics_, true, out) && writeBaseline(timingsPath, metrics_, false, out);
+    }
+    if (!haveTimings && !writeBaseline(timingsPath, metrics_, false, out)) return false;
+    if (!haveCounts) {
+        out << RED << "Error: " << RESET << "no count baseline at " << countsPath << "; run make update" << std::endl;
+        return false;
+    }
+
+    if (ok) out << GREEN << "No regressions beyond " << thresholdPercent_ << "%" << RESET << std::endl;
+    else out << RED << "Regressions beyond " << thresholdPercent_ << "% (or in exact counts)" << RESET << std::endl;
+    return ok;
+}
@@ -0,0 +1,81 @@
+#ifndef SUITE_H
+#define SUITE_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+struct Metric {
+    std::string name;
+    double value;
+    std::string unit;
+    // Deterministic metrics (operation counts) regress on any increase;
+    // timings only beyond the threshold.
+    bool exact;
+};
+
+// Collects metrics and checks them against baseline files with one
+// "name value unit" line per metric. Exact counts are the same on every
+// machine and have a baseline under version control; timings only compare
+// with earlier runs on the same machine and have a local one.
+class Suite {
+private:
+    // Each timed trial runs for at least this long. The fastest of TRIALS
+    // trials is reported: interference only ever adds time, so the minimum
+    // is the most repeatable figure to gate on.
+    static constexpr long long MIN_TRIAL_NS = 20000000;
+    static constexpr size_t TRIALS = 7;
+
+    double thresholdPercent_;
+    std::vector<Metric> metrics_;
+
+public:
+    explicit Suite(double thresholdPercent);
+
+    Suite(const Suite &other);
+
+    Suite &operator=(const Suite &other);
+
+    ~Suite();
+
+    // Records nanoseconds per operation; every call of op performs
+    // opsPerCall operations.
+    template<typename Op>
+    void time(const std::string &name, size_t opsPerCall, Op op);
+
+    void count(const std::string &name, double value, const std::string &unit);
+
+    // Prints every metric next to its baseline. Writes both baselines when
+    // update is set, and the timing baseline when it does not exist yet.
+    // Returns false if a metric regressed or the count baseline is missing.
+    [[nodiscard]] bool check(const std::string &countsPath, const std::string &timingsPath, bool update,
+                             std::ostream &out) const;
+};
+
+template<typename Op>
+void Suite::time(const std::string &name, const size_t opsPerCall, Op op) {
+    typedef std::chrono::steady_clock Clock;
+
+    std::cerr << "bench " << name << std::endl;
+    // The first call warms caches and lazily built tables, and calibrates
+    // how many calls make up one trial.
+    const Clock::time_point w0 = Clock::now();
+    op();
+    const long long once = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - w0).count();
+    const size_t calls = static_cast<size_t>(std::max(1LL, MIN_TRIAL_NS / std::max(1LL, once)));
+
+    std::vector<double> perOp;
+    for (size_t t = 0; t < TRIALS; ++t) {
+        const Clock::time_point t0 = Clock::now();
+        for (size_t i = 0; i < calls; ++i) op();
+        const long long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count();
+        perOp.push_back(static_cast<double>(ns) / static_cast<double>(calls * opsPerCall));
+    }
+    metrics_.push_back(Metric{name, *std::min_element(perOp.begin(), perOp.end()), "ns/op", false});
+}
+
+#endif //SUITE_H
@@ -0,0 +1,238 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "Suite.h"
+#include "../ex00/BitcoinExchange.h"
+#include "../ex01/RPN.h"
+#include "../ex01/colors.h"
+#include "../ex02/FordJohnson.hpp"
+
+// Every dataset comes from this seed, so each run measures the same work.
+static const unsigned int SEED = 42;
+
+static const int DB_DAYS = 4000;
+static const size_t INPUT_LINES = 10000;
+static const size_t LOOKUPS = 10000;
+static const size_t EXPRESSIONS = 2000;
+static const size_t SORT_SIZES[] = {16, 256, 4096, 65536};
+
+// Results are folded in here so that the measured calls cannot be optimized away.
+static volatile double g_sink;
+
+static void printUsage(const char *name) {
+    std::cerr << YELLOW << "Usage: " << RESET << name
+            << " [--counts <file>] [--baseline <file>] [--threshold <percent>] [--update]" << std::endl;
+}
+
+static std::string formatDate(const int year, const int month, const int day) {
+    char buffer[40];
+    std::snprintf(buffer, sizeof(buffer), "%04d-%02d-%02d", year, month, day);
+    return buffer;
+}
+
+// Consecutive days from 2012-01-01 onwards.
+static std::vector<std::string> generateDates(const int days) {
+    static const int daysInMonth[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    std::vector<std::string> dates;
+    int year = 2012;
+    int month = 1;
+    int day = 1;
+    for (int i = 0; i < days; ++i) {
+        dates.push_back(formatDate(year, month, day));
+        const bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+        if (++day > daysInMonth[month - 1] + (month == 2 && leap ? 1 : 0)) {
+            day = 1;
+            if (++month > 12) {
+                month = 1;
+                ++year;
+            }
+        }
+    }
+    return dates;
+}
+
+static void writeRateDb(const std::string &path, const std::vector<std::string> &dates, std::mt19937 &rng) {
+    std::uniform_real_distribution<double> rate(1.0, 60000.0);
+    std::ofstream file(path);
+    file << "date,exchange_rate\n";
+    for (const std::string &date: dates) file << date << ',' << static_cast<int>(rate(rng) * 100) / 100.0 << '\n';
+}
+
+// Mostly valid "date | value" lines plus the kinds of mistakes the
+// validator has to catch.
+static std::vector<std::string> generateInputLines(const std::vector<std::string> &dates, std::mt19937 &rng) {
+    std::uniform_int_distribution<size_t> pickDate(0, dates.size() - 1);
+    std::uniform_int_distribution<int> pickKind(0, 9);
+    std::uniform_int_distribution<int> value(0, 100000);
+    std::vector<std::string> lines;
+    for (size_t i = 0; i < INPUT_LINES; ++i) {
+        const std::string date = dates[pickDate(rng)];
+        const std::string amount = std::to_string(value(rng) / 100.0);
+        switch (pickKind(rng)) {
+            case 0: lines.push_back(date + " | -" + amount); break;
+            case 1: lines.push_back(date + " | 2147483648"); break;
+            case 2: lines.push_back("2014-02-30 | " + amount); break;
+            case 3: lines.push_back(date + " " + amount); break;
+            default: lines.push_back(date + " | " + amount); break;
+        }
+    }
+    return lines;
+}
+
+// Valid expressions of single digits. A division always follows a pushed
+// digit, which is never zero, so no expression throws.
+static std::vector<std::string> generateExpressions(std::mt19937 &rng) {
+    static const char operators[] = {'+', '-', '*', '/'};
+    std::uniform_int_distribution<int> digit(1, 9);
+    std::uniform_int_distribution<int> coin(0, 1);
+    std::uniform_int_distribution<int> pickOperator(0, 3);
+    std::vector<std::string> expressions;
+    for (size_t i = 0; i < EXPRESSIONS; ++i) {
+        std::string expression(1, static_cast<char>('0' + digit(rng)));
+        int depth = 1;
+        bool lastWasDigit = true;
+        for (int tokens = 0; tokens < 24; ++tokens) {
+            char token;
+            if (depth < 2 || (depth < 6 && coin(rng))) {
+                token = static_cast<char>('0' + digit(rng));
+                ++depth;
+            } else {
+                token = operators[pickOperator(rng)];
+                if (token == '/' && !lastWasDigit) token = '+';
+                --depth;
+            }
+            lastWasDigit = token >= '0' && token <= '9';
+            expression += ' ';
+            expression += token;
+        }
+        for (; depth > 1; --depth) expression += " +";
+        expressions.push_back(expression);
+    }
+    return expressions;
+}
+
+static std::vector<int> generateInts(const size_t n, std::mt19937 &rng) {
+    std::uniform_int_distribution<int> dist(0, 1 << 30);
+    std::vector<int> values(n);
+    for (int &v: values) v = dist(rng);
+    return values;
+}
+
+static void benchExchange(Suite &suite) {
+    std::mt19937 rng(SEED);
+    const std::vector<std::string> dates = generateDates(DB_DAYS);
+    const std::string dbPath = (std::filesystem::temp_directory_path()
+                                / ("bench-rates-" + std::to_string(getpid()) + ".csv")).string();
+    writeRateDb(dbPath, dates, rng);
+
+    suite.time("btc.db_load", DB_DAYS, [&dbPath] {
+        const BitcoinExchange btc(dbPath);
+        g_sink = btc.isError();
+    });
+
+    const std::vector<std::string> lines = generateInputLines(dates, rng);
+    suite.time("btc.validate_line", lines.size(), [&lines] {
+        std::string errorMsg;
+        size_t errorColumn = 0;
+        size_t valid = 0;
+        for (const std::string &line: lines) valid += BitcoinExchange::isValidInputLine(line, errorMsg, errorColumn);
+        g_sink = static_cast<double>(valid);
+    });
+
+    const BitcoinExchange btc(dbPath);
+    std::filesystem::remove(dbPath);
+    if (btc.isError()) throw std::runtime_error("generated rate database did not load");
+
+    // Half exact hits; the other half ask for day 32 of a month, which is
+    // never in the database and takes the lower_bound path.
+    std::vector<std::string> queries;
+    std::uniform_int_distribution<size_t> pickDate(0, dates.size() - 1);
+    for (size_t i = 0; i < LOOKUPS; ++i) {
+        const std::string &date = dates[pickDate(rng)];
+        queries.push_back(i % 2 == 0 ? date : date.substr(0, 8) + "32");
+    }
+    suite.time("btc.get_exchange_rate", queries.size(), [&btc, &queries] {
+        double total = 0;
+        for (const std::string &date: queries) total += btc.getExchangeRate(date);
+        g_sink = total;
+    });
+}
+
+static void benchRpn(Suite &suite) {
+    std::mt19937 rng(SEED);
+    const std::vector<std::string> expressions = generateExpressions(rng);
+    RPN calculator;
+    suite.time("rpn.evaluate", expressions.size(), [&calculator, &expressions] {
+        double total = 0;
+        for (const std::string &expression: expressions) total += calculator.evaluate(expression);
+        g_sink = total;
+    });
+}
+
+static void benchFordJohnson(Suite &suite) {
+    std::mt19937 rng(SEED);
+    for (const size_t n: SORT_SIZES) {
+        const std::vector<int> input = generateInts(n, rng);
+        const std::string size = std::to_string(n);
+
+        FordJohnson<std::vector<int> > sorter;
+        suite.time("pmerge.sort.n=" + size, n, [&sorter, &input] {
+            const std::vector<int> sorted = sorter.sort(input);
+            g_sink = sorted.front();
+        });
+
+        FordJohnson<std::vector<int>, CountingInstrumentation> counter;
+        const std::vector<int> counted = counter.sort(input);
+        if (!std::is_sorted(counted.begin(), counted.end()))
+            throw std::runtime_error("FordJohnson produced unsorted output for n=" + size);
+        suite.count("pmerge.comparisons.n=" + size, static_cast<double>(counter.getComparisons()), "comparisons");
+    }
+}
+
+int main(const int argc, char **argv) {
+    std::string countsPath = "baseline-counts.txt";
+    std::string baselinePath = "baseline.txt";
+    double threshold = 25.0;
+    bool update = false;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--counts" && i + 1 < argc) {
+            countsPath = argv[++i];
+        } else if (arg == "--baseline" && i + 1 < argc) {
+            baselinePath = argv[++i];
+        } else if (arg == "--threshold" && i + 1 < argc) {
+            char *end = nullptr;
+            threshold = std::strtod(argv[++i], &end);
+            if (*end != '\0' || threshold < 0) {
+                std::cerr << RED << "Error: " << RESET << "invalid threshold '" << argv[i] << "'" << std::endl;
+                return EXIT_FAILURE;
+            }
+        } else if (arg == "--update") {
+            update = true;
+        } else {
+            printUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    Suite suite(threshold);
+    try {
+        benchExchange(suite);
+        benchRpn(suite);
+        benchFordJohnson(suite);
+    } catch (const std::exception &e) {
+        std::cerr << RED << "Error: " << RESET << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return suite.check(countsPath, baselinePath, update, std::cout) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
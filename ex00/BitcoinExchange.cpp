@@ -6,13 +6,14 @@
 #include "colors.h"
 
 #include <iostream>
+#include <sstream>
 #include <chrono>
 
 const std::string BitcoinExchange::INPUT_SEPARATOR = " | ";
 const std::string BitcoinExchange::DB_FILE_HEADER = "date,exchange_rate";
 const std::string BitcoinExchange::INPUT_FILE_HEADER = "date | value";
 
-BitcoinExchange::BitcoinExchange(const std::string &dbFilePath, const std::string &inputFilePath) : error(false) {
+BitcoinExchange::BitcoinExchange(const std::string &dbFilePath) : error(false) {
     std::optional<std::ifstream> dbFile = openDbFile(dbFilePath);
     if (!dbFile.has_value()) {
         error = true;
@@ -20,6 +21,10 @@ BitcoinExchange::BitcoinExchange(const std::string &dbFilePath, const std::strin
     }
     error = !parseDbFile(dbFile.value());
     dbFile->close();
+}
+
+BitcoinExchange::BitcoinExchange(const std::string &dbFilePath, const std::string &inputFilePath)
+    : BitcoinExchange(dbFilePath) {
     if (error)
         return;
 
@@ -90,21 +95,15 @@ bool BitcoinExchange::processInputFile(std::ifstream &inputFile) {
             continue;
         }
 
+        std::string result;
         std::string errorMsg;
         size_t errorColumn;
-        if (!isValidInputLine(line, errorMsg, errorColumn)) {
+        if (!convert(line, result, errorMsg, errorColumn)) {
             displayError(errorMsg, line, errorColumn, lineNumber);
             continue;
         }
 
-        const size_t pipePos = line.find(INPUT_SEPARATOR);
-        const std::string date = line.substr(0, pipePos);
-        const std::string valueStr = line.substr(pipePos + INPUT_SEPARATOR.length());
-        const float value = std::stof(valueStr);
-        const float rate = getExchangeRate(date);
-        const float result = value * rate;
-
-        std::cout << date << " => " << valueStr << " = " << result << std::endl;
+        std::cout << result << std::endl;
         lineNumber++;
     }
 
@@ -115,6 +114,23 @@ bool BitcoinExchange::processInputFile(std::ifstream &inputFile) {
     return true;
 }
 
+bool BitcoinExchange::convert(const std::string &line, std::string &result, std::string &errorMsg,
+                              size_t &errorColumn) const {
+    if (!isValidInputLine(line, errorMsg, errorColumn))
+        return false;
+
+    const size_t pipePos = line.find(INPUT_SEPARATOR);
+    const std::string date = line.substr(0, pipePos);
+    const std::string valueStr = line.substr(pipePos + INPUT_SEPARATOR.length());
+    const float value = std::stof(valueStr);
+    const float rate = getExchangeRate(date);
+
+    std::ostringstream out;
+    out << date << " => " << valueStr << " = " << value * rate;
+    result = out.str();
+    return true;
+}
+
 std::pair<std::string, float> BitcoinExchange::parseDbLine(const std::string &line) {
     const size_t commaPos = line.find(',');
     if (commaPos == std::string::npos) {
@@ -154,7 +170,7 @@ bool BitcoinExchange::isValidKeyValue(const std::string &key, const
                                       size_t &errorColumn,
                                       const size_t keyStartPos,
                                       const size_t valueStartPos) {
-    const std::regex datePattern(R"(^\d{4,}-(0[1-9]|1[0-2])-(0[1-9]|[12]\d|3[01])$)");
+    static const std::regex datePattern(R"(^\d{4,}-(0[1-9]|1[0-2])-(0[1-9]|[12]\d|3[01])$)");
     if (!std::regex_match(key, datePattern)) {
         errorMsg = "Invalid date format (expected YYYY-MM-DD with valid ranges)";
         errorColumn = keyStartPos;
@@ -211,7 +227,7 @@ bool BitcoinExchange::isValidKeyValue(const std::string &key, const
         return false;
     }
 
-    const std::regex floatPattern(R"(^[+-]?(\d+\.?\d*|\.\d+)[fF]?$)");
+    static const std::regex floatPattern(R"(^[+-]?(\d+\.?\d*|\.\d+)[fF]?$)");
     if (!std::regex_match(value, floatPattern)) {
         errorMsg = "Invalid float format";
         errorColumn = valueStartPos;
@@ -277,7 +293,7 @@ bool BitcoinExchange::isValidInputLine(const std::string &line, std::string &err
     return true;
 }
 
-float BitcoinExchange::getExchangeRate(const std::string &date) {
+float BitcoinExchange::getExchangeRate(const std::string &date) const {
     auto it = exchangeRates.find(date);
     if (it != exchangeRates.end()) {
         return it->second;
@@ -25,6 +25,9 @@ private:
     static const std::string INPUT_FILE_HEADER;
 
 public:
+    // Loads the rate database only; queries go through convert().
+    explicit BitcoinExchange(const std::string &dbFilePath);
+
     BitcoinExchange(const std::string &dbFilePath, const std::string &inputFilePath);
 
     BitcoinExchange(const BitcoinExchange &other);
@@ -38,7 +41,12 @@ public:
 
     [[nodiscard]] bool processInputFile(std::ifstream &inputFile);
 
-    [[nodiscard]] float getExchangeRate(const std::string &date);
+    [[nodiscard]] float getExchangeRate(const std::string &date) const;
+
+    // Validates one "date | value" line and formats its conversion as
+    // "date => value = result".
+    [[nodiscard]] bool convert(const std::string &line, std::string &result, std::string &errorMsg,
+                               size_t &errorColumn) const;
 
     [[nodiscard]] static std::pair<std::string, float> parseDbLine(const std::string &line);
 
@@ -0,0 +1,423 @@
+#include "ExchangeServer.h"
+#include "colors.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static std::runtime_error systemError(const std::string &what) {
+    return std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+// A socket left behind by a previous run would make bind() fail. It is
+// stale only if connecting to it is refused; a running server keeps it.
+static void removeStaleSocket(const sockaddr_un &address) {
+    struct stat st{};
+    if (stat(address.sun_path, &st) != 0 || !S_ISSOCK(st.st_mode))
+        return;
+
+    const int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (probe < 0)
+        throw systemError("socket");
+    const bool refused = connect(probe, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) < 0
+                         && errno == ECONNREFUSED;
+    close(probe);
+    if (!refused)
+        throw std::runtime_error("Socket path '" + std::string(address.sun_path) + "' is already in use");
+    unlink(address.sun_path);
+}
+
+LatencyHistogram::LatencyHistogram() : buckets(), count(0), totalNs(0), maxNs(0) {
+}
+
+LatencyHistogram::LatencyHistogram(const LatencyHistogram &other) : count(other.count), totalNs(other.totalNs),
+                                                                    maxNs(other.maxNs) {
+    std::copy(other.buckets, other.buckets + BUCKETS, buckets);
+}
+
+LatencyHistogram &LatencyHistogram::operator=(const LatencyHistogram &other) {
+    if (this != &other) {
+        std::copy(other.buckets, other.buckets + BUCKETS, buckets);
+        count = other.count;
+        totalNs = other.totalNs;
+        maxNs = other.maxNs;
+    }
+    return *this;
+}
+
+LatencyHistogram::~LatencyHistogram() = default;
+
+void LatencyHistogram::record(const uint64_t ns) {
+    size_t bucket = 0;
+    for (uint64_t us = ns / 1000; us > 0 && bucket + 1 < BUCKETS; us >>= 1)
+        ++bucket;
+    ++buckets[bucket];
+    ++count;
+    totalNs += ns;
+    maxNs = std::max(maxNs, ns);
+}
+
+void LatencyHistogram::report(std::ostream &out, const std::string &name) const {
+    out << name << ": " << count << " requests";
+    if (count == 0) {
+        out << std::endl;
+        return;
+    }
+    out << ", mean " << static_cast<double>(totalNs) / count / 1000.0 << "us, max "
+            << static_cast<double>(maxNs) / 1000.0 << "us" << std::endl;
+    for (size_t k = 0; k < BUCKETS; ++k) {
+        if (buckets[k] == 0)
+            continue;
+        const uint64_t lower = k == 0 ? 0 : uint64_t(1) << (k - 1);
+        out << "  [" << lower << ", " << (uint64_t(1) << k) << ") us: " << buckets[k] << std::endl;
+    }
+}
+
+ExchangeServer::ExchangeServer(const BitcoinExchange &exchange) : exchange(exchange), epollFd(-1), signalFd(-1),
+                                                                  listenFd(-1), pollStdin(false), running(false),
+                                                                  nextClient(FIRST_CLIENT), batches(0) {
+}
+
+ExchangeServer::~ExchangeServer() {
+    shutdown();
+}
+
+void ExchangeServer::setup() {
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    sigprocmask(SIG_BLOCK, &signals, nullptr);
+    // A client that disconnects early must not kill the server.
+    std::signal(SIGPIPE, SIG_IGN);
+
+    signalFd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (signalFd < 0)
+        throw systemError("signalfd");
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd < 0)
+        throw systemError("epoll_create1");
+
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.u64 = SIGNAL_TAG;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, signalFd, &event) < 0)
+        throw systemError("epoll_ctl");
+}
+
+void ExchangeServer::serveSocket(const std::string &path) {
+    setup();
+
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(address.sun_path))
+        throw std::runtime_error("Invalid socket path '" + path + "'");
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    removeStaleSocket(address);
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listenFd < 0)
+        throw systemError("socket");
+    if (bind(listenFd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0)
+        throw systemError("bind " + path);
+    socketPath = path;
+    if (listen(listenFd, SOMAXCONN) < 0)
+        throw systemError("listen");
+
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.u64 = LISTEN_TAG;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &event) < 0)
+        throw systemError("epoll_ctl");
+
+    std::cout << GREEN << "Listening on " << RESET << path << std::endl;
+    loop();
+    report();
+    shutdown();
+}
+
+void ExchangeServer::serveStdio() {
+    setup();
+
+    Client &client = clients[STDIO_CLIENT];
+    client.inFd = STDIN_FILENO;
+    client.outFd = STDOUT_FILENO;
+    client.skipping = false;
+    client.closing = false;
+    client.reading = true;
+    client.writing = false;
+
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.u64 = STDIO_CLIENT;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, STDIN_FILENO, &event) < 0) {
+        if (errno != EPERM)
+            throw systemError("epoll_ctl stdin");
+        pollStdin = true;
+    }
+
+    loop();
+    report();
+    shutdown();
+}
+
+void ExchangeServer::loop() {
+    epoll_event events[MAX_EVENTS];
+    running = true;
+    while (running) {
+        const int ready = epoll_wait(epollFd, events, MAX_EVENTS, pollStdin ? 0 : -1);
+        if (ready < 0) {
+            if (errno == EINTR)
+                continue;
+            throw systemError("epoll_wait");
+        }
+
+        for (int i = 0; i < ready; ++i) {
+            const uint64_t tag = events[i].data.u64;
+            if (tag == LISTEN_TAG) {
+                acceptClients();
+            } else if (tag == SIGNAL_TAG) {
+                running = false;
+            } else {
+                const auto it = clients.find(tag);
+                if (it == clients.end())
+                    continue;
+                if ((events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) && it->second.reading)
+                    readClient(tag);
+                if ((events[i].events & EPOLLOUT) && clients.count(tag))
+                    writeClient(tag);
+            }
+        }
+        if (pollStdin && clients.count(STDIO_CLIENT))
+            readClient(STDIO_CLIENT);
+
+        processBatch();
+    }
+}
+
+void ExchangeServer::acceptClients() {
+    while (true) {
+        const int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                std::cerr << RED << "Error: " << RESET << "accept: " << std::strerror(errno) << std::endl;
+            return;
+        }
+
+        const uint64_t id = nextClient++;
+        Client &client = clients[id];
+        client.inFd = fd;
+        client.outFd = fd;
+        client.skipping = false;
+        client.closing = false;
+        client.reading = true;
+        client.writing = false;
+
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.u64 = id;
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) < 0) {
+            close(fd);
+            clients.erase(id);
+        }
+    }
+}
+
+void ExchangeServer::readClient(const uint64_t id) {
+    Client &client = clients[id];
+    const Clock::time_point received = Clock::now();
+    char buffer[64 * 1024];
+
+    while (true) {
+        const ssize_t got = read(client.inFd, buffer, sizeof(buffer));
+        // One read per client and wakeup bounds the batch size, and with it
+        // the latency of every request in the batch. Level-triggered epoll
+        // reports the rest on the next wakeup.
+        if (got > 0) {
+            client.input.append(buffer, static_cast<size_t>(got));
+            splitLines(id, client, received);
+            return;
+        }
+        if (got < 0 && errno == EINTR)
+            continue;
+        if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return;
+        if (got < 0) {
+            closeClient(id);
+            return;
+        }
+
+        // End of input: a final line without a newline is still a request.
+        if (!client.input.empty() && !client.skipping)
+            batch.push_back(Request{id, client.input, received, false, false});
+        client.input.clear();
+        client.closing = true;
+        client.reading = false;
+        updateInterest(id, client);
+        return;
+    }
+}
+
+void ExchangeServer::splitLines(const uint64_t id, Client &client, const Clock::time_point received) {
+    size_t start = 0;
+    size_t newline;
+    while ((newline = client.input.find('\n', start)) != std::string::npos) {
+        if (client.skipping) {
+            client.skipping = false;
+        } else {
+            size_t end = newline;
+            if (end > start && client.input[end - 1] == '\r')
+                --end;
+            if (end - start > MAX_LINE)
+                batch.push_back(Request{id, std::string(), received, true, false});
+            else
+                batch.push_back(Request{id, client.input.substr(start, end - start), received, false, false});
+        }
+        start = newline + 1;
+    }
+    client.input.erase(0, start);
+
+    if (client.input.size() > MAX_LINE) {
+        if (!client.skipping)
+            batch.push_back(Request{id, std::string(), received, true, false});
+        client.skipping = true;
+        client.input.clear();
+    }
+}
+
+void ExchangeServer::processBatch() {
+    // Requests of clients that went away during this wakeup need no answer.
+    batch.erase(std::remove_if(batch.begin(), batch.end(), [this](const Request &r) {
+        return clients.count(r.client) == 0;
+    }), batch.end());
+
+    if (!batch.empty()) {
+        ++batches;
+        for (Request &request: batch) {
+            std::string &output = clients[request.client].output;
+            if (request.overlong) {
+                output += "Error: Line is longer than " + std::to_string(MAX_LINE) + " bytes\n";
+                continue;
+            }
+            std::string result;
+            std::string errorMsg;
+            size_t errorColumn;
+            request.ok = exchange.convert(request.line, result, errorMsg, errorColumn);
+            output += request.ok ? result : "Error: " + errorMsg;
+            output += '\n';
+        }
+    }
+
+    std::vector<uint64_t> pending;
+    for (const auto &[id, client]: clients) {
+        if (!client.output.empty() || client.closing)
+            pending.push_back(id);
+    }
+    for (const uint64_t id: pending)
+        writeClient(id);
+
+    const Clock::time_point done = Clock::now();
+    for (const Request &request: batch) {
+        const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(done - request.received).count();
+        (request.ok ? converted : rejected).record(static_cast<uint64_t>(ns));
+    }
+    batch.clear();
+}
+
+void ExchangeServer::writeClient(const uint64_t id) {
+    Client &client = clients[id];
+    size_t sent = 0;
+    while (sent < client.output.size()) {
+        const ssize_t put = write(client.outFd, client.output.data() + sent, client.output.size() - sent);
+        if (put >= 0) {
+            sent += static_cast<size_t>(put);
+            continue;
+        }
+        if (errno == EINTR)
+            continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            if (id != STDIO_CLIENT)
+                break;
+            // stdout is not registered with epoll; wait for it here.
+            pollfd out{client.outFd, POLLOUT, 0};
+            poll(&out, 1, -1);
+            continue;
+        }
+        closeClient(id);
+        return;
+    }
+    client.output.erase(0, sent);
+
+    if (client.output.empty() && client.closing) {
+        closeClient(id);
+        return;
+    }
+    const bool reading = !client.closing && client.output.size() < MAX_OUTPUT;
+    const bool writing = !client.output.empty();
+    if (reading != client.reading || writing != client.writing) {
+        client.reading = reading;
+        client.writing = writing;
+        updateInterest(id, client);
+    }
+}
+
+void ExchangeServer::updateInterest(const uint64_t id, const Client &client) {
+    if (id == STDIO_CLIENT)
+        return;
+    epoll_event event{};
+    if (client.reading)
+        event.events |= EPOLLIN;
+    if (client.writing)
+        event.events |= EPOLLOUT;
+    event.data.u64 = id;
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, client.inFd, &event);
+}
+
+void ExchangeServer::closeClient(const uint64_t id) {
+    const auto it = clients.find(id);
+    if (it == clients.end())
+        return;
+    if (id == STDIO_CLIENT) {
+        if (!pollStdin)
+            epoll_ctl(epollFd, EPOLL_CTL_DEL, it->second.inFd, nullptr);
+        running = false;
+    } else {
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, it->second.inFd, nullptr);
+        close(it->second.inFd);
+    }
+    clients.erase(it);
+}
+
+void ExchangeServer::report() const {
+    std::cerr << "batches: " << batches << std::endl;
+    converted.report(std::cerr, "converted");
+    rejected.report(std::cerr, "rejected");
+}
+
+void ExchangeServer::shutdown() {
+    while (!clients.empty())
+        closeClient(clients.begin()->first);
+    if (listenFd >= 0) {
+        close(listenFd);
+        unlink(socketPath.c_str());
+    }
+    if (signalFd >= 0)
+        close(signalFd);
+    if (epollFd >= 0)
+        close(epollFd);
+    listenFd = signalFd = epollFd = -1;
+}
@@ -0,0 +1,137 @@
+#ifndef EXCHANGESERVER_H
+#define EXCHANGESERVER_H
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "BitcoinExchange.h"
+
+// Request latencies in power-of-two microsecond buckets: bucket 0 holds
+// everything below 1us, bucket k holds [2^(k-1), 2^k) us.
+class LatencyHistogram {
+private:
+    static constexpr size_t BUCKETS = 32;
+
+    uint64_t buckets[BUCKETS];
+    uint64_t count;
+    uint64_t totalNs;
+    uint64_t maxNs;
+
+public:
+    LatencyHistogram();
+
+    LatencyHistogram(const LatencyHistogram &other);
+
+    LatencyHistogram &operator=(const LatencyHistogram &other);
+
+    ~LatencyHistogram();
+
+    void record(uint64_t ns);
+
+    void report(std::ostream &out, const std::string &name) const;
+};
+
+// Answers "date | value" lines with the same conversion the file mode
+// prints, against a database that is loaded once. Every request line gets
+// exactly one response line: "date => value = result" or "Error: <message>".
+//
+// Clients are local stream sockets or stdin/stdout. A single thread waits on
+// epoll; all lines that became complete during one wakeup are converted as
+// one batch before any response is written. A client that does not read
+// its responses is not read from either until they drain. SIGINT, SIGTERM
+// or the end of stdin stop the loop, after which the latency histograms go
+// to stderr.
+class ExchangeServer {
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    static constexpr size_t MAX_LINE = 4096;
+    // A client is not read from while this many response bytes wait for it.
+    static constexpr size_t MAX_OUTPUT = 1024 * 1024;
+    static constexpr int MAX_EVENTS = 64;
+
+    // epoll tags for the non-client descriptors; client ids start above them.
+    static constexpr uint64_t LISTEN_TAG = 0;
+    static constexpr uint64_t SIGNAL_TAG = 1;
+    static constexpr uint64_t STDIO_CLIENT = 2;
+    static constexpr uint64_t FIRST_CLIENT = 16;
+
+    struct Client {
+        int inFd;
+        int outFd;
+        std::string input;
+        std::string output;
+        // Set after an overlong line until its newline has been skipped.
+        bool skipping;
+        bool closing;
+        // Mirror the events registered with epoll.
+        bool reading;
+        bool writing;
+    };
+
+    struct Request {
+        uint64_t client;
+        std::string line;
+        Clock::time_point received;
+        bool overlong;
+        bool ok;
+    };
+
+    const BitcoinExchange &exchange;
+    int epollFd;
+    int signalFd;
+    int listenFd;
+    std::string socketPath;
+    // Regular files cannot be registered with epoll; they are read on every
+    // loop iteration instead.
+    bool pollStdin;
+    bool running;
+    uint64_t nextClient;
+    std::unordered_map<uint64_t, Client> clients;
+    std::vector<Request> batch;
+    LatencyHistogram converted;
+    LatencyHistogram rejected;
+    uint64_t batches;
+
+    void setup();
+
+    void loop();
+
+    void acceptClients();
+
+    void readClient(uint64_t id);
+
+    void splitLines(uint64_t id, Client &client, Clock::time_point received);
+
+    void processBatch();
+
+    void writeClient(uint64_t id);
+
+    void closeClient(uint64_t id);
+
+    void updateInterest(uint64_t id, const Client &client);
+
+    void report() const;
+
+    void shutdown();
+
+public:
+    explicit ExchangeServer(const BitcoinExchange &exchange);
+
+    ExchangeServer(const ExchangeServer &other) = delete;
+
+    ExchangeServer &operator=(const ExchangeServer &other) = delete;
+
+    ~ExchangeServer();
+
+    // Both throw std::runtime_error if the descriptors cannot be set up.
+    void serveSocket(const std::string &path);
+
+    void serveStdio();
+};
+
+#endif //EXCHANGESERVER_H
@@ -1,11 +1,60 @@
 #include <iostream>
+#include <string>
 
 #include "BitcoinExchange.h"
+#include "ExchangeServer.h"
 #include "colors.h"
 
+static void printUsage(const char *name) {
+    std::cerr << "Usage: " << name << " <inputfile>" << std::endl;
+    std::cerr << "       " << name << " --serve <socket path> [--db <file>]" << std::endl;
+    std::cerr << "       " << name << " --stdio [--db <file>]" << std::endl;
+}
+
+// Keeps the database loaded and answers "date | value" lines until stopped.
+static int serve(const int argc, char **argv) {
+    const std::string mode = argv[1];
+    int next = 2;
+    std::string socketPath;
+    if (mode == "--serve") {
+        if (argc < 3) {
+            printUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        socketPath = argv[next++];
+    }
+
+    std::string dbPath = "data.csv";
+    if (next + 2 == argc && std::string(argv[next]) == "--db") {
+        dbPath = argv[next + 1];
+    } else if (next != argc) {
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const BitcoinExchange btc(dbPath);
+    if (btc.isError())
+        return EXIT_FAILURE;
+
+    try {
+        ExchangeServer server(btc);
+        if (mode == "--serve")
+            server.serveSocket(socketPath);
+        else
+            server.serveStdio();
+    } catch (const std::exception &e) {
+        std::cerr << RED << "Error: " << RESET << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
 int main(const int argc, char **argv) {
+    if (argc >= 2 && (std::string(argv[1]) == "--serve" || std::string(argv[1]) == "--stdio"))
+        return serve(argc, argv);
+
     if (argc != 2) {
-        std::cerr << "Usage: " << argv[0] << " <inputfile>" << std::endl;
+        printUsage(argv[0]);
         return EXIT_FAILURE;
     }
 
@@ -37,78 +37,131 @@ bool RPN::isValidNumber(const std::string& token) const {
     return true;
 }
 
-double RPN::performOperation(double a, double b, const std::string& op) const {
-    if (op == "+") return a + b;
-    if (op == "-") return a - b;
-    if (op == "*") return a * b;
-    if (op == "/") {
-        if (b == 0) {
-            throw std::runtime_error("Division by zero is not allowed");
-        }
-        return a / b;
-    }
-    throw std::runtime_error("Unknown operator '" + op + "'");
+RPN::Instruction::Kind RPN::operatorKind(const std::string& token) const {
+    if (token == "+") return Instruction::ADD;
+    if (token == "-") return Instruction::SUB;
+    if (token == "*") return Instruction::MUL;
+    return Instruction::DIV;
 }
 
-double RPN::evaluate(const std::string& expression) {
-    // Clear the stack for each evaluation
-    while (!_stack.empty()) {
-        _stack.pop();
+double RPN::performOperation(double a, double b, Instruction::Kind op) const {
+    switch (op) {
+        case Instruction::ADD: return a + b;
+        case Instruction::SUB: return a - b;
+        case Instruction::MUL: return a * b;
+        case Instruction::DIV:
+            if (b == 0) {
+                throw std::runtime_error("Division by zero is not allowed");
+            }
+            return a / b;
+        default:
+            throw std::runtime_error("Unknown operator");
     }
+}
+
+static RPN::Program& fail(RPN::Program& program, const std::string& error) {
+    RPN::Instruction instruction;
+    instruction.kind = RPN::Instruction::FAIL;
+    instruction.value = 0;
+    program.code.push_back(instruction);
+    program.error = error;
+    return program;
+}
+
+RPN::Program RPN::compile(const std::string& expression) const {
+    Program program;
 
     if (expression.empty()) {
-        throw std::runtime_error("Empty expression provided");
+        return fail(program, "Empty expression provided");
     }
 
     std::istringstream iss(expression);
     std::string token;
     int tokenCount = 0;
+    size_t depth = 0;
 
     while (iss >> token) {
         tokenCount++;
 
         if (isValidNumber(token)) {
-            double num = std::stod(token);
+            double num;
+            try {
+                num = std::stod(token);
+            } catch (const std::exception& e) {
+                return fail(program, e.what());
+            }
             if (num >= 10 || num <= -10) {
-                throw std::runtime_error("Numbers must be single digits (less than 10), found: " + token);
+                return fail(program, "Numbers must be single digits (less than 10), found: " + token);
             }
-            _stack.push(num);
+            Instruction instruction;
+            instruction.kind = Instruction::PUSH;
+            instruction.value = num;
+            program.code.push_back(instruction);
+            depth++;
         }
         else if (isOperator(token)) {
-            if (_stack.size() < 2) {
-                throw std::runtime_error("Insufficient operands for operator '" + token + "' (need 2, have " + std::to_string(_stack.size()) + ")");
+            if (depth < 2) {
+                return fail(program, "Insufficient operands for operator '" + token + "' (need 2, have " + std::to_string(depth) + ")");
             }
-
-            double b = _stack.top();
-            _stack.pop();
-            double a = _stack.top();
-            _stack.pop();
-
-            double result = performOperation(a, b, token);
-            _stack.push(result);
+            Instruction instruction;
+            instruction.kind = operatorKind(token);
+            instruction.value = 0;
+            program.code.push_back(instruction);
+            depth--;
         }
         else {
             if (token.find('(') != std::string::npos || token.find(')') != std::string::npos) {
-                throw std::runtime_error("Parentheses are not supported in RPN notation");
+                return fail(program, "Parentheses are not supported in RPN notation");
             }
             if (token.find('.') != std::string::npos) {
-                throw std::runtime_error("Decimal numbers are not supported, found: " + token);
+                return fail(program, "Decimal numbers are not supported, found: " + token);
             }
-            throw std::runtime_error("Invalid token '" + token + "' (only single digits and operators +, -, *, / are allowed)");
+            return fail(program, "Invalid token '" + token + "' (only single digits and operators +, -, *, / are allowed)");
         }
     }
 
     if (tokenCount == 0) {
-        throw std::runtime_error("No tokens found in expression");
+        return fail(program, "No tokens found in expression");
     }
 
-    if (_stack.size() != 1) {
-        if (_stack.size() == 0) {
-            throw std::runtime_error("Expression resulted in empty stack (possibly too many operators)");
+    if (depth != 1) {
+        if (depth == 0) {
+            return fail(program, "Expression resulted in empty stack (possibly too many operators)");
         } else {
-            throw std::runtime_error("Expression incomplete: " + std::to_string(_stack.size()) + " values remain on stack (need exactly 1)");
+            return fail(program, "Expression incomplete: " + std::to_string(depth) + " values remain on stack (need exactly 1)");
+        }
+    }
+
+    return program;
+}
+
+double RPN::execute(const Program& program) {
+    // Clear the stack for each evaluation
+    while (!_stack.empty()) {
+        _stack.pop();
+    }
+
+    for (size_t i = 0; i < program.code.size(); ++i) {
+        const Instruction& instruction = program.code[i];
+        if (instruction.kind == Instruction::PUSH) {
+            _stack.push(instruction.value);
+        }
+        else if (instruction.kind == Instruction::FAIL) {
+            throw std::runtime_error(program.error);
+        }
+        else {
+            double b = _stack.top();
+            _stack.pop();
+            double a = _stack.top();
+            _stack.pop();
+
+            _stack.push(performOperation(a, b, instruction.kind));
         }
     }
 
     return _stack.top();
 }
+
+double RPN::evaluate(const std::string& expression) {
+    return execute(compile(expression));
+}
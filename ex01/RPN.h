@@ -3,14 +3,33 @@
 
 #include <string>
 #include <stack>
+#include <vector>
 
 class RPN {
+public:
+    struct Instruction {
+        enum Kind { PUSH, ADD, SUB, MUL, DIV, FAIL };
+
+        Kind kind;
+        double value;
+    };
+
+    // A tokenized and validated expression. Syntax and stack-depth errors
+    // are found while compiling but only raised by a FAIL instruction at the
+    // point where evaluate() would have hit them, so a division by zero
+    // earlier in the expression is still reported first.
+    struct Program {
+        std::vector<Instruction> code;
+        std::string error;
+    };
+
 private:
     std::stack<double> _stack;
 
     bool isOperator(const std::string& token) const;
     bool isValidNumber(const std::string& token) const;
-    double performOperation(double a, double b, const std::string& op) const;
+    Instruction::Kind operatorKind(const std::string& token) const;
+    double performOperation(double a, double b, Instruction::Kind op) const;
 
 public:
     RPN();
@@ -18,6 +37,8 @@ public:
     RPN& operator=(const RPN& other);
     ~RPN();
 
+    Program compile(const std::string& expression) const;
+    double execute(const Program& program);
     double evaluate(const std::string& expression);
 };
 
@@ -0,0 +1,402 @@
+#include "RPNServer.h"
+
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#include <arpa/inet.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "colors.h"
+
+static std::runtime_error systemError(const std::string& what) {
+    return std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+// A socket left behind by a previous run would make bind() fail, so it is
+// removed; but only if nothing accepts on it, or a second server would
+// take the path away from a running one.
+static void removeStaleSocket(const sockaddr_un& address) {
+    struct stat st;
+    if (stat(address.sun_path, &st) != 0 || !S_ISSOCK(st.st_mode)) return;
+
+    const int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (probe < 0) throw systemError("socket");
+    const bool refused = connect(probe, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0
+                         && errno == ECONNREFUSED;
+    close(probe);
+    if (!refused) throw std::runtime_error("Socket path '" + std::string(address.sun_path) + "' is already in use");
+    unlink(address.sun_path);
+}
+
+static void appendFrame(std::string& out, const std::string& payload) {
+    const uint32_t length = htonl(static_cast<uint32_t>(payload.size()));
+    out.append(reinterpret_cast<const char*>(&length), sizeof(length));
+    out.append(payload);
+}
+
+ProgramCache::ProgramCache(size_t capacity) : capacity_(capacity) {}
+
+ProgramCache::~ProgramCache() {}
+
+std::shared_ptr<const RPN::Program> ProgramCache::get(const std::string& expression, const RPN& compiler) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::unordered_map<std::string, Entry>::iterator it = entries_.find(expression);
+        if (it != entries_.end()) {
+            order_.splice(order_.begin(), order_, it->second.position);
+            return it->second.program;
+        }
+    }
+
+    // Compile outside the lock; two workers racing on the same expression
+    // just compile it twice.
+    std::shared_ptr<const RPN::Program> program = std::make_shared<const RPN::Program>(compiler.compile(expression));
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (entries_.find(expression) == entries_.end()) {
+        order_.push_front(expression);
+        Entry entry;
+        entry.program = program;
+        entry.position = order_.begin();
+        entries_[expression] = entry;
+        if (entries_.size() > capacity_) {
+            entries_.erase(order_.back());
+            order_.pop_back();
+        }
+    }
+    return program;
+}
+
+RPNServer::RPNServer(const std::string& socketPath, size_t workers)
+    : _socketPath(socketPath), _workerCount(workers == 0 ? 1 : workers), _listenFd(-1), _epollFd(-1),
+      _wakeFd(-1), _signalFd(-1), _nextConnection(FIRST_CONNECTION), _cache(CACHE_SIZE), _stopping(false) {}
+
+RPNServer::~RPNServer() {
+    shutdown();
+}
+
+void RPNServer::setup() {
+    // Signals are consumed through a signalfd by the event loop; block them
+    // before any worker starts so that the workers inherit the mask.
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+    _signalFd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (_signalFd < 0) throw systemError("signalfd");
+
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (_socketPath.empty() || _socketPath.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("Invalid socket path '" + _socketPath + "'");
+    }
+    std::memcpy(address.sun_path, _socketPath.c_str(), _socketPath.size() + 1);
+
+    removeStaleSocket(address);
+
+    _listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (_listenFd < 0) throw systemError("socket");
+    if (bind(_listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        // The path belongs to someone else; shutdown() must not unlink it.
+        const std::runtime_error error = systemError("bind " + _socketPath);
+        close(_listenFd);
+        _listenFd = -1;
+        throw error;
+    }
+    if (listen(_listenFd, SOMAXCONN) < 0) throw systemError("listen");
+
+    _wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (_wakeFd < 0) throw systemError("eventfd");
+    _epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (_epollFd < 0) throw systemError("epoll_create1");
+
+    const int fds[] = {_listenFd, _wakeFd, _signalFd};
+    const uint64_t tags[] = {LISTEN_TAG, WAKE_TAG, SIGNAL_TAG};
+    for (size_t i = 0; i < 3; ++i) {
+        epoll_event event;
+        std::memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN;
+        event.data.u64 = tags[i];
+        if (epoll_ctl(_epollFd, EPOLL_CTL_ADD, fds[i], &event) < 0) throw systemError("epoll_ctl");
+    }
+}
+
+void RPNServer::run() {
+    setup();
+    for (size_t i = 0; i < _workerCount; ++i) {
+        _workers.push_back(std::thread(&RPNServer::workerLoop, this));
+    }
+    std::cout << GREEN << "Listening on " << RESET << _socketPath << " with " << _workerCount << " worker(s)" << std::endl;
+
+    epoll_event events[64];
+    bool running = true;
+    while (running) {
+        const int ready = epoll_wait(_epollFd, events, 64, -1);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            throw systemError("epoll_wait");
+        }
+        for (int i = 0; i < ready; ++i) {
+            const uint64_t tag = events[i].data.u64;
+            if (tag == LISTEN_TAG) {
+                acceptClients();
+            } else if (tag == WAKE_TAG) {
+                drainCompletions();
+            } else if (tag == SIGNAL_TAG) {
+                running = false;
+            } else {
+                std::unordered_map<uint64_t, Connection>::iterator it = _connections.find(tag);
+                if (it == _connections.end()) continue;
+                const bool reading = it->second.events & EPOLLIN;
+                // A client that is gone entirely cannot take its answers;
+                // when it is not being read, nothing else would notice.
+                if ((events[i].events & (EPOLLHUP | EPOLLERR)) && !reading) {
+                    closeClient(tag);
+                    continue;
+                }
+                if ((events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) && reading) readClient(tag);
+                if ((events[i].events & EPOLLOUT) && _connections.count(tag)) writeClient(tag);
+            }
+        }
+    }
+    std::cout << YELLOW << "Shutting down" << RESET << std::endl;
+    shutdown();
+}
+
+void RPNServer::acceptClients() {
+    while (true) {
+        const int fd = accept4(_listenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                std::cerr << RED << "Error: " << RESET << "accept: " << std::strerror(errno) << std::endl;
+            }
+            if (errno == EINTR) continue;
+            return;
+        }
+
+        const uint64_t id = _nextConnection++;
+        Connection& connection = _connections[id];
+        connection.fd = fd;
+        connection.busy = false;
+        connection.closing = false;
+        connection.events = EPOLLIN;
+
+        epoll_event event;
+        std::memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN;
+        event.data.u64 = id;
+        if (epoll_ctl(_epollFd, EPOLL_CTL_ADD, fd, &event) < 0) {
+            close(fd);
+            _connections.erase(id);
+        }
+    }
+}
+
+void RPNServer::readClient(uint64_t id) {
+    std::unordered_map<uint64_t, Connection>::iterator it = _connections.find(id);
+    if (it == _connections.end()) return;
+    Connection& connection = it->second;
+
+    // One read per wakeup bounds how much one client can queue at once;
+    // level-triggered epoll reports the rest on the next wakeup.
+    char buffer[64 * 1024];
+    ssize_t got;
+    do {
+        got = recv(connection.fd, buffer, sizeof(buffer), 0);
+    } while (got < 0 && errno == EINTR);
+    if (got < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK) closeClient(id);
+        return;
+    }
+    if (got == 0) connection.closing = true;
+    else connection.input.append(buffer, static_cast<size_t>(got));
+
+    size_t offset = 0;
+    while (connection.input.size() - offset >= sizeof(uint32_t)) {
+        uint32_t length;
+        std::memcpy(&length, connection.input.data() + offset, sizeof(length));
+        length = ntohl(length);
+        if (length > MAX_FRAME) {
+            closeClient(id);
+            return;
+        }
+        if (connection.input.size() - offset - sizeof(length) < length) break;
+        connection.pending.push_back(connection.input.substr(offset + sizeof(length), length));
+        offset += sizeof(length) + length;
+    }
+    connection.input.erase(0, offset);
+    // A partial frame at end of input can never be completed.
+    if (connection.closing) connection.input.clear();
+    dispatch(id);
+    settle(id);
+}
+
+void RPNServer::writeClient(uint64_t id) {
+    Connection& connection = _connections[id];
+    size_t sent = 0;
+    while (sent < connection.output.size()) {
+        const ssize_t put = send(connection.fd, connection.output.data() + sent, connection.output.size() - sent,
+                                 MSG_NOSIGNAL);
+        if (put >= 0) {
+            sent += static_cast<size_t>(put);
+            continue;
+        }
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+        closeClient(id);
+        return;
+    }
+    connection.output.erase(0, sent);
+    settle(id);
+}
+
+// Closes a half-closed connection once every answer is out, and otherwise
+// brings its epoll interest up to date.
+void RPNServer::settle(uint64_t id) {
+    std::unordered_map<uint64_t, Connection>::iterator it = _connections.find(id);
+    if (it == _connections.end()) return;
+    Connection& connection = it->second;
+    if (connection.closing && !connection.busy && connection.pending.empty() && connection.output.empty()) {
+        closeClient(id);
+        return;
+    }
+    updateInterest(connection, id);
+}
+
+void RPNServer::updateInterest(Connection& connection, uint64_t id) {
+    const bool backlogged = connection.pending.size() >= MAX_PENDING || connection.output.size() >= MAX_OUTPUT;
+    uint32_t events = 0;
+    if (!connection.closing && !backlogged) events |= EPOLLIN;
+    if (!connection.output.empty()) events |= EPOLLOUT;
+    if (events == connection.events) return;
+    connection.events = events;
+
+    epoll_event event;
+    std::memset(&event, 0, sizeof(event));
+    event.events = events;
+    event.data.u64 = id;
+    epoll_ctl(_epollFd, EPOLL_CTL_MOD, connection.fd, &event);
+}
+
+void RPNServer::closeClient(uint64_t id) {
+    std::unordered_map<uint64_t, Connection>::iterator it = _connections.find(id);
+    if (it == _connections.end()) return;
+    epoll_ctl(_epollFd, EPOLL_CTL_DEL, it->second.fd, NULL);
+    close(it->second.fd);
+    _connections.erase(it);
+}
+
+void RPNServer::dispatch(uint64_t id) {
+    Connection& connection = _connections[id];
+    if (connection.busy || connection.pending.empty()) return;
+
+    Job job;
+    job.connection = id;
+    while (!connection.pending.empty() && job.requests.size() < MAX_BATCH) {
+        job.requests.push_back(connection.pending.front());
+        connection.pending.pop_front();
+    }
+    connection.busy = true;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _jobs.push_back(job);
+    }
+    _jobReady.notify_one();
+}
+
+void RPNServer::drainCompletions() {
+    uint64_t counter;
+    while (read(_wakeFd, &counter, sizeof(counter)) > 0) {
+    }
+
+    std::vector<Completion> completions;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        completions.swap(_completions);
+    }
+    for (size_t i = 0; i < completions.size(); ++i) {
+        const uint64_t id = completions[i].connection;
+        // The client may have disconnected while its batch was running.
+        if (!_connections.count(id)) continue;
+        Connection& connection = _connections[id];
+        connection.busy = false;
+        connection.output.append(completions[i].responses);
+        writeClient(id);
+        if (!_connections.count(id)) continue;
+        dispatch(id);
+        settle(id);
+    }
+}
+
+std::string RPNServer::evaluate(RPN& calculator, const std::string& expression) {
+    try {
+        const std::shared_ptr<const RPN::Program> program = _cache.get(expression, calculator);
+        char result[64];
+        // Same formatting as printing the double with std::cout.
+        std::snprintf(result, sizeof(result), "%g", calculator.execute(*program));
+        return std::string("OK ") + result;
+    }
+    catch (const std::exception& e) {
+        return std::string("ERR ") + e.what();
+    }
+}
+
+void RPNServer::workerLoop() {
+    RPN calculator;
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            while (!_stopping && _jobs.empty()) _jobReady.wait(lock);
+            if (_stopping) return;
+            job = _jobs.front();
+            _jobs.pop_front();
+        }
+
+        Completion completion;
+        completion.connection = job.connection;
+        for (size_t i = 0; i < job.requests.size(); ++i) {
+            appendFrame(completion.responses, evaluate(calculator, job.requests[i]));
+        }
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _completions.push_back(completion);
+        }
+        const uint64_t one = 1;
+        if (write(_wakeFd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+            std::cerr << RED << "Error: " << RESET << "eventfd write: " << std::strerror(errno) << std::endl;
+        }
+    }
+}
+
+void RPNServer::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _jobReady.notify_all();
+    for (size_t i = 0; i < _workers.size(); ++i) {
+        if (_workers[i].joinable()) _workers[i].join();
+    }
+    _workers.clear();
+
+    while (!_connections.empty()) closeClient(_connections.begin()->first);
+    const int fds[] = {_listenFd, _wakeFd, _signalFd, _epollFd};
+    for (size_t i = 0; i < 4; ++i) {
+        if (fds[i] >= 0) close(fds[i]);
+    }
+    if (_listenFd >= 0) unlink(_socketPath.c_str());
+    _listenFd = _wakeFd = _signalFd = _epollFd = -1;
+}
@@ -0,0 +1,134 @@
+#ifndef RPNSERVER_H
+#define RPNSERVER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "RPN.h"
+
+// Compiled programs shared by all workers, least recently used evicted first.
+class ProgramCache {
+private:
+    typedef std::list<std::string> Order;
+
+    struct Entry {
+        std::shared_ptr<const RPN::Program> program;
+        Order::iterator position;
+    };
+
+    size_t capacity_;
+    std::mutex mutex_;
+    Order order_;
+    std::unordered_map<std::string, Entry> entries_;
+
+public:
+    explicit ProgramCache(size_t capacity);
+
+    ProgramCache(const ProgramCache& other) = delete;
+    ProgramCache& operator=(const ProgramCache& other) = delete;
+    ~ProgramCache();
+
+    std::shared_ptr<const RPN::Program> get(const std::string& expression, const RPN& compiler);
+};
+
+// Evaluates RPN expressions for local clients over a Unix domain socket.
+//
+// Protocol: every request is a 4-byte big-endian length followed by that
+// many bytes of expression. Every response is framed the same way and
+// carries "OK <result>" or "ERR <message>". Clients may pipeline any number
+// of requests; responses come back in request order.
+//
+// One thread runs an epoll loop that accepts clients and frames requests.
+// Complete requests of a client are handed to a small worker pool as one
+// batch; a client has at most one batch in flight, which keeps its
+// responses ordered. Workers report back through an eventfd. A client that
+// shuts down its write side still gets every answer before the server
+// closes the connection.
+class RPNServer {
+private:
+    static const uint32_t MAX_FRAME = 64 * 1024;
+    static const size_t MAX_BATCH = 256;
+    static const size_t CACHE_SIZE = 4096;
+    // A client is not read from while this many requests wait for a worker
+    // or this many response bytes wait for the client.
+    static const size_t MAX_PENDING = 4 * MAX_BATCH;
+    static const size_t MAX_OUTPUT = 1024 * 1024;
+
+    // epoll tags for the non-client descriptors; client ids start above them.
+    static const uint64_t LISTEN_TAG = 0;
+    static const uint64_t WAKE_TAG = 1;
+    static const uint64_t SIGNAL_TAG = 2;
+    static const uint64_t FIRST_CONNECTION = 16;
+
+    struct Connection {
+        int fd;
+        std::string input;
+        std::string output;
+        std::deque<std::string> pending;
+        bool busy;
+        // The client has shut down its write side; no more requests follow.
+        bool closing;
+        // Events currently registered with epoll.
+        uint32_t events;
+    };
+
+    struct Job {
+        uint64_t connection;
+        std::vector<std::string> requests;
+    };
+
+    struct Completion {
+        uint64_t connection;
+        std::string responses;
+    };
+
+    std::string _socketPath;
+    size_t _workerCount;
+    int _listenFd;
+    int _epollFd;
+    int _wakeFd;
+    int _signalFd;
+    uint64_t _nextConnection;
+    std::unordered_map<uint64_t, Connection> _connections;
+    ProgramCache _cache;
+
+    std::vector<std::thread> _workers;
+    std::mutex _mutex;
+    std::condition_variable _jobReady;
+    std::deque<Job> _jobs;
+    std::vector<Completion> _completions;
+    bool _stopping;
+
+    void setup();
+    void acceptClients();
+    void readClient(uint64_t id);
+    void writeClient(uint64_t id);
+    void closeClient(uint64_t id);
+    void dispatch(uint64_t id);
+    void drainCompletions();
+    void settle(uint64_t id);
+    void updateInterest(Connection& connection, uint64_t id);
+    void workerLoop();
+    std::string evaluate(RPN& calculator, const std::string& expression);
+    void shutdown();
+
+public:
+    RPNServer(const std::string& socketPath, size_t workers);
+
+    RPNServer(const RPNServer& other) = delete;
+    RPNServer& operator=(const RPNServer& other) = delete;
+    ~RPNServer();
+
+    // Serves until SIGINT or SIGTERM; throws std::runtime_error if the socket cannot be set up.
+    void run();
+};
+
+#endif
@@ -1,11 +1,45 @@
+#include <cstdlib>
 #include <iostream>
+#include <string>
 #include "RPN.h"
+#include "RPNServer.h"
 #include "colors.h"
 
+static int serve(const int argc, char **argv) {
+    size_t workers = 4;
+    if (argc == 5 && std::string(argv[3]) == "--workers") {
+        char *end = NULL;
+        const long value = std::strtol(argv[4], &end, 10);
+        if (*argv[4] == '\0' || *end != '\0' || value <= 0 || value > 256) {
+            std::cerr << RED << "Error: " << RESET << "Invalid worker count '" << argv[4] << "'." << std::endl;
+            return EXIT_FAILURE;
+        }
+        workers = static_cast<size_t>(value);
+    } else if (argc != 3) {
+        std::cerr << YELLOW << "Usage: " << RESET << argv[0] << " --serve <socket path> [--workers N]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    try {
+        RPNServer server(argv[2], workers);
+        server.run();
+    }
+    catch (const std::exception& e) {
+        std::cerr << RED << "Error: " << RESET << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
 int main(const int argc, char **argv) {
+    if (argc >= 3 && std::string(argv[1]) == "--serve") {
+        return serve(argc, argv);
+    }
+
     if (argc != 2) {
         std::cerr << RED << "Error: " << RESET << "Invalid number of arguments." << std::endl;
         std::cerr << YELLOW << "Usage: " << RESET << argv[0] << " \"<RPN expression>\"" << std::endl;
+        std::cerr << YELLOW << "       " << RESET << argv[0] << " --serve <socket path> [--workers N]" << std::endl;
         std::cerr << CYAN << "Example: " << RESET << argv[0] << " \"8 9 * 9 - 9 - 9 - 4 - 1 +\"" << std::endl;
         return EXIT_FAILURE;
     }
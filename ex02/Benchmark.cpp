@@ -0,0 +1,295 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <climits>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <memory_resource>
+#include <random>
+#include <stdexcept>
+
+#include "FordJohnson.hpp"
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Heap allocations a sorter makes through its upstream resource. Only the
+// benchmark's sorters use it; the rest of pmerge allocates as usual.
+class AllocationCounter : public std::pmr::memory_resource {
+private:
+    unsigned long long count_;
+
+    void *do_allocate(const size_t bytes, const size_t alignment) override {
+        ++count_;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void *p, const size_t bytes, const size_t alignment) override {
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+
+    [[nodiscard]] bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+        return this == &other;
+    }
+
+public:
+    AllocationCounter() : count_(0) {}
+
+    AllocationCounter(const AllocationCounter &other) = delete;
+
+    AllocationCounter &operator=(const AllocationCounter &other) = delete;
+
+    [[nodiscard]] unsigned long long count() const { return count_; }
+};
+
+// Hardware cache-miss counter for the calling thread. Stays unavailable
+// when the kernel or the sandbox does not allow perf events.
+class PerfCounter {
+private:
+    int fd_;
+
+public:
+    PerfCounter() : fd_(-1) {
+#if defined(__linux__)
+        perf_event_attr attr{};
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd_ = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+    }
+
+    PerfCounter(const PerfCounter &other) = delete;
+
+    PerfCounter &operator=(const PerfCounter &other) = delete;
+
+    ~PerfCounter() {
+#if defined(__linux__)
+        if (fd_ >= 0) close(fd_);
+#endif
+    }
+
+    [[nodiscard]] bool available() const { return fd_ >= 0; }
+
+    void start() const {
+#if defined(__linux__)
+        if (fd_ < 0) return;
+        ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+    }
+
+    [[nodiscard]] long long stop() const {
+#if defined(__linux__)
+        if (fd_ < 0) return -1;
+        ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+        long long value = 0;
+        if (read(fd_, &value, sizeof(value)) != static_cast<ssize_t>(sizeof(value))) return -1;
+        return value;
+#else
+        return -1;
+#endif
+    }
+};
+
+Benchmark::Benchmark(const BenchmarkConfig &config) : config_(config) {
+}
+
+Benchmark::Benchmark(const Benchmark &other) : config_(other.config_), results_(other.results_) {
+}
+
+Benchmark &Benchmark::operator=(const Benchmark &other) {
+    if (this != &other) {
+        config_ = other.config_;
+        results_ = other.results_;
+    }
+    return *this;
+}
+
+Benchmark::~Benchmark() = default;
+
+std::vector<int> Benchmark::generate(const Distribution distribution, const size_t n, const unsigned int seed) {
+    std::mt19937 rng(seed);
+    std::vector<int> values(n);
+    switch (distribution) {
+        case Distribution::RANDOM: {
+            std::uniform_int_distribution<int> dist(1, INT_MAX);
+            for (size_t i = 0; i < n; ++i) values[i] = dist(rng);
+            break;
+        }
+        case Distribution::SORTED:
+            for (size_t i = 0; i < n; ++i) values[i] = static_cast<int>(i) + 1;
+            break;
+        case Distribution::REVERSED:
+            for (size_t i = 0; i < n; ++i) values[i] = static_cast<int>(n - i);
+            break;
+        case Distribution::FEW_UNIQUE: {
+            std::uniform_int_distribution<int> dist(1, 8);
+            for (size_t i = 0; i < n; ++i) values[i] = dist(rng);
+            break;
+        }
+        case Distribution::ORGAN_PIPE:
+            for (size_t i = 0; i < n; ++i) values[i] = static_cast<int>(i < n / 2 ? i + 1 : n - i);
+            break;
+    }
+    return values;
+}
+
+bool Benchmark::parseDistribution(const std::string &name, Distribution &out) {
+    static const Distribution all[] = {
+        Distribution::RANDOM, Distribution::SORTED, Distribution::REVERSED,
+        Distribution::FEW_UNIQUE, Distribution::ORGAN_PIPE
+    };
+    for (const Distribution d: all) {
+        if (name == distributionName(d)) {
+            out = d;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char *Benchmark::distributionName(const Distribution distribution) {
+    switch (distribution) {
+        case Distribution::RANDOM: return "random";
+        case Distribution::SORTED: return "sorted";
+        case Distribution::REVERSED: return "reversed";
+        case Distribution::FEW_UNIQUE: return "few-unique";
+        case Distribution::ORGAN_PIPE: return "organ-pipe";
+    }
+    return "unknown";
+}
+
+long long Benchmark::comparisonLowerBound(const size_t n) {
+    long double bits = 0;
+    for (size_t k = 2; k <= n; ++k) bits += std::log2(static_cast<long double>(k));
+    // Absorb rounding noise so that exact powers of two do not round up.
+    return static_cast<long long>(std::ceil(bits - 1e-9L));
+}
+
+template<typename Container>
+BenchmarkResult Benchmark::measure(const char *name, const std::vector<int> &input, const Distribution distribution) {
+    const Container source(input.begin(), input.end());
+    // Outlives the sorter, which returns its arena on destruction.
+    AllocationCounter heap;
+    FordJohnson<Container> sorter(config_.baseCase, &heap);
+    PerfCounter perf;
+
+    for (size_t i = 0; i < config_.warmup; ++i) {
+        Container copy = source;
+        const Container sorted = sorter.sort(std::move(copy));
+    }
+
+    std::vector<long long> times;
+    std::vector<long long> allocations;
+    std::vector<long long> misses;
+    bool sortedOk = true;
+    for (size_t i = 0; i < config_.trials; ++i) {
+        Container copy = source;
+        const unsigned long long a0 = heap.count();
+        perf.start();
+        const auto t0 = std::chrono::steady_clock::now();
+        const Container sorted = sorter.sort(std::move(copy));
+        const auto t1 = std::chrono::steady_clock::now();
+        const long long missCount = perf.stop();
+        const unsigned long long a1 = heap.count();
+
+        times.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+        allocations.push_back(static_cast<long long>(a1 - a0));
+        misses.push_back(missCount);
+        if (!std::is_sorted(sorted.begin(), sorted.end())) sortedOk = false;
+    }
+    if (!sortedOk) throw std::runtime_error(std::string(name) + " produced unsorted output");
+
+    // Counts come from a separate instrumented run so the timed sorter stays
+    // free of instrumentation.
+    FordJohnson<Container, CountingInstrumentation> counter(config_.baseCase);
+    const Container counted = counter.sort(source);
+
+    std::sort(times.begin(), times.end());
+    std::sort(allocations.begin(), allocations.end());
+    std::sort(misses.begin(), misses.end());
+
+    BenchmarkResult r;
+    r.container = name;
+    r.distribution = distribution;
+    r.n = input.size();
+    r.trials = times.size();
+    r.medianNs = times[times.size() / 2];
+    r.maxNs = times.back();
+    r.p99Ns = -1;
+    if (times.size() >= MIN_P99_TRIALS) r.p99Ns = times[static_cast<size_t>(std::ceil(0.99 * times.size())) - 1];
+    r.minNs = times.front();
+    r.comparisons = static_cast<long long>(counter.getComparisons());
+    r.comparisonBound = comparisonLowerBound(input.size());
+    r.moves = static_cast<long long>(counter.getInstrumentation().total().moves);
+    r.allocations = allocations[allocations.size() / 2];
+    r.cacheMisses = perf.available() ? misses[misses.size() / 2] : -1;
+    return r;
+}
+
+bool Benchmark::run() {
+    results_.clear();
+    if (config_.trials == 0) config_.trials = 1;
+    try {
+        for (const size_t n: config_.sizes) {
+            for (const Distribution d: config_.distributions) {
+                const std::vector<int> input = generate(d, n, config_.seed);
+                std::cerr << "bench " << distributionName(d) << " n=" << n << std::endl;
+                results_.push_back(measure<std::vector<int> >("vector", input, d));
+                results_.push_back(measure<std::deque<int> >("deque", input, d));
+            }
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void Benchmark::write(std::ostream &out) const {
+    if (config_.json) {
+        out << "[\n";
+        for (size_t i = 0; i < results_.size(); ++i) {
+            const BenchmarkResult &r = results_[i];
+            out << "  {\"container\": \"" << r.container << "\", \"distribution\": \""
+                    << distributionName(r.distribution) << "\", \"n\": " << r.n
+                    << ", \"trials\": " << r.trials << ", \"median_ns\": " << r.medianNs
+                    << ", \"max_ns\": " << r.maxNs << ", \"p99_ns\": ";
+            if (r.p99Ns < 0) out << "null";
+            else out << r.p99Ns;
+            out << ", \"min_ns\": " << r.minNs
+                    << ", \"comparisons\": " << r.comparisons << ", \"comparison_bound\": " << r.comparisonBound
+                    << ", \"moves\": " << r.moves
+                    << ", \"allocations\": " << r.allocations << ", \"cache_misses\": ";
+            if (r.cacheMisses < 0) out << "null";
+            else out << r.cacheMisses;
+            out << "}" << (i + 1 < results_.size() ? "," : "") << "\n";
+        }
+        out << "]" << std::endl;
+        return;
+    }
+
+    out << "container,distribution,n,trials,median_ns,max_ns,p99_ns,min_ns,comparisons,comparison_bound,moves,"
+            "allocations,cache_misses\n";
+    for (const BenchmarkResult &r: results_) {
+        out << r.container << ',' << distributionName(r.distribution) << ',' << r.n << ',' << r.trials << ','
+                << r.medianNs << ',' << r.maxNs << ',';
+        if (r.p99Ns >= 0) out << r.p99Ns;
+        out << ',' << r.minNs << ',' << r.comparisons << ','
+                << r.comparisonBound << ',' << r.moves << ',' << r.allocations << ',';
+        if (r.cacheMisses >= 0) out << r.cacheMisses;
+        out << '\n';
+    }
+    out.flush();
+}
@@ -0,0 +1,86 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "FordJohnson.hpp"
+
+enum class Distribution {
+    RANDOM,
+    SORTED,
+    REVERSED,
+    FEW_UNIQUE,
+    ORGAN_PIPE
+};
+
+struct BenchmarkConfig {
+    std::vector<size_t> sizes;
+    std::vector<Distribution> distributions;
+    size_t warmup;
+    size_t trials;
+    unsigned int seed;
+    bool json;
+    BaseCase baseCase;
+};
+
+struct BenchmarkResult {
+    std::string container;
+    Distribution distribution;
+    size_t n;
+    size_t trials;
+    long long medianNs;
+    long long maxNs;
+    // -1 unless there were at least MIN_P99_TRIALS trials; with fewer, the
+    // 99th percentile is just the maximum.
+    long long p99Ns;
+    long long minNs;
+    long long comparisons;
+    long long comparisonBound;
+    long long moves;
+    // Heap allocations the sorter made in one timed sort; the median trial.
+    long long allocations;
+    // -1 when hardware counters are not available.
+    long long cacheMisses;
+};
+
+// Repeated, warmed-up timings of both FordJohnson instantiations over a
+// sweep of sizes and input distributions.
+class Benchmark {
+private:
+    // Fewest trials for which the 99th percentile differs from the maximum.
+    static constexpr size_t MIN_P99_TRIALS = 100;
+
+    BenchmarkConfig config_;
+    std::vector<BenchmarkResult> results_;
+
+    template<typename Container>
+    BenchmarkResult measure(const char *name, const std::vector<int> &input, Distribution distribution);
+
+public:
+    explicit Benchmark(const BenchmarkConfig &config);
+
+    Benchmark(const Benchmark &other);
+
+    Benchmark &operator=(const Benchmark &other);
+
+    ~Benchmark();
+
+    [[nodiscard]] static std::vector<int> generate(Distribution distribution, size_t n, unsigned int seed);
+
+    [[nodiscard]] static bool parseDistribution(const std::string &name, Distribution &out);
+
+    [[nodiscard]] static const char *distributionName(Distribution distribution);
+
+    // ceil(log2(n!)): no comparison sort can do better in the worst case.
+    [[nodiscard]] static long long comparisonLowerBound(size_t n);
+
+    // Runs every configuration; returns false if any result was not sorted.
+    [[nodiscard]] bool run();
+
+    void write(std::ostream &out) const;
+};
+
+#endif //BENCHMARK_H
@@ -0,0 +1,165 @@
+#include "ExternalSort.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <stdexcept>
+
+#include <unistd.h>
+
+ExternalSort::ExternalSort(const size_t memoryBytes, const Algorithm algorithm)
+    : memoryBytes_(memoryBytes), algorithm_(algorithm), runCount_(0) {
+}
+
+ExternalSort::~ExternalSort() {
+    closeRuns(0, runFds_.size());
+}
+
+size_t ExternalSort::runCapacity() const {
+    if (algorithm_ == Algorithm::FAST) return std::max<size_t>(memoryBytes_ / sizeof(int), 1024);
+    // Ford-Johnson needs its scratch arena on top of the run itself.
+    const size_t bytesPerElement = (1 + FordJohnson<std::vector<int> >::SCRATCH_INTS_PER_ELEMENT) * sizeof(int);
+    return std::clamp<size_t>(memoryBytes_ / bytesPerElement, 1024, MAX_FORD_JOHNSON_RUN);
+}
+
+void ExternalSort::sortRun() {
+    if (algorithm_ == Algorithm::FORD_JOHNSON) run_ = sorter_.sort(std::move(run_));
+    else std::sort(run_.begin(), run_.end());
+}
+
+int ExternalSort::createTempFile() {
+    const char *dir = std::getenv("TMPDIR");
+    std::string path = std::string(dir && *dir ? dir : "/tmp") + "/pmerge-run-XXXXXX";
+    const int fd = mkstemp(path.data());
+    if (fd < 0) throw std::runtime_error(std::string("cannot create temporary file: ") + std::strerror(errno));
+    unlink(path.c_str());
+    return fd;
+}
+
+int ExternalSort::spillRun() const {
+    const int fd = createTempFile();
+    try {
+        IntWriter writer(fd, IntFormat::BINARY);
+        writer.write(run_.data(), run_.size());
+        writer.flush();
+    } catch (...) {
+        close(fd);
+        throw;
+    }
+    return fd;
+}
+
+void ExternalSort::closeRuns(const size_t from, const size_t to) {
+    for (size_t i = from; i < to; ++i) close(runFds_[i]);
+    runFds_.erase(runFds_.begin() + static_cast<std::ptrdiff_t>(from), runFds_.begin() + static_cast<std::ptrdiff_t>(to));
+}
+
+void ExternalSort::mergeGroup(const std::vector<int> &runs, IntWriter &out) const {
+    struct Cursor {
+        std::unique_ptr<IntReader> reader;
+        std::vector<int> values;
+        size_t pos;
+        size_t size;
+    };
+
+    constexpr size_t MIN_BLOCK = 16 * 1024;
+    const size_t block = std::max(memoryBytes_ / ((runs.size() + 1) * 2 * sizeof(int)), MIN_BLOCK);
+
+    std::vector<Cursor> cursors(runs.size());
+    typedef std::pair<int, size_t> Head;
+    std::priority_queue<Head, std::vector<Head>, std::greater<Head> > heap;
+    for (size_t i = 0; i < runs.size(); ++i) {
+        if (lseek(runs[i], 0, SEEK_SET) < 0)
+            throw std::runtime_error(std::string("cannot rewind run: ") + std::strerror(errno));
+        Cursor &c = cursors[i];
+        c.reader = std::make_unique<IntReader>(runs[i], IntFormat::BINARY, block * sizeof(int));
+        c.values.resize(block);
+        c.pos = 0;
+        c.size = c.reader->read(c.values.data(), block);
+        if (c.size > 0) heap.push(Head(c.values[0], i));
+    }
+
+    std::vector<int> output;
+    output.reserve(block);
+    while (!heap.empty()) {
+        const size_t i = heap.top().second;
+        output.push_back(heap.top().first);
+        heap.pop();
+        if (output.size() == block) {
+            out.write(output.data(), output.size());
+            output.clear();
+        }
+
+        Cursor &c = cursors[i];
+        if (++c.pos == c.size) {
+            c.pos = 0;
+            c.size = c.reader->read(c.values.data(), block);
+        }
+        if (c.pos < c.size) heap.push(Head(c.values[c.pos], i));
+    }
+    out.write(output.data(), output.size());
+}
+
+size_t ExternalSort::sort(IntReader &in, IntWriter &out) {
+    const size_t capacity = runCapacity();
+    size_t total = 0;
+    runCount_ = 0;
+
+    while (true) {
+        // Grow the run while reading so that small inputs do not pay for
+        // the whole budget up front.
+        constexpr size_t READ_CHUNK = 1 << 20;
+        size_t got = 0;
+        while (got < capacity) {
+            run_.resize(std::min(capacity, got + READ_CHUNK));
+            const size_t n = in.read(run_.data() + got, run_.size() - got);
+            if (n == 0) break;
+            got += n;
+        }
+        if (got == 0) break;
+        run_.resize(got);
+        total += got;
+        ++runCount_;
+        sortRun();
+
+        // Everything fit into the first run: no need to touch the disk.
+        if (runFds_.empty() && got < capacity) {
+            out.write(run_.data(), run_.size());
+            out.flush();
+            return total;
+        }
+        runFds_.push_back(spillRun());
+        if (got < capacity) break;
+    }
+    std::vector<int>().swap(run_);
+
+    while (runFds_.size() > MAX_FAN_IN) {
+        // Merged runs are appended behind the pending ones, so every group
+        // of this pass is taken from the front.
+        const size_t pending = runFds_.size();
+        for (size_t done = 0; done < pending;) {
+            const size_t take = std::min(MAX_FAN_IN, pending - done);
+            const std::vector<int> group(runFds_.begin(), runFds_.begin() + static_cast<std::ptrdiff_t>(take));
+            done += take;
+            const int merged = createTempFile();
+            runFds_.push_back(merged);
+            IntWriter writer(merged, IntFormat::BINARY);
+            mergeGroup(group, writer);
+            writer.flush();
+            closeRuns(0, group.size());
+        }
+    }
+
+    mergeGroup(runFds_, out);
+    out.flush();
+    closeRuns(0, runFds_.size());
+    return total;
+}
+
+size_t ExternalSort::getRunCount() const {
+    return runCount_;
+}
@@ -0,0 +1,68 @@
+#ifndef EXTERNALSORT_H
+#define EXTERNALSORT_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "FordJohnson.hpp"
+#include "IntStream.h"
+
+// Sorts a stream that may not fit into memory. Input is cut into runs that
+// fit the memory budget; each run is sorted in memory and, unless it turns
+// out to be the whole input, spilled to an unlinked temporary file. The
+// runs are then combined with a k-way merge.
+class ExternalSort {
+public:
+    enum class Algorithm {
+        FAST,
+        FORD_JOHNSON
+    };
+
+    // Upper bound on Ford-Johnson runs, whatever the memory budget. Its
+    // inserts move O(n) elements each, so a run of this size takes about
+    // 0.4 s, while one of a million elements takes minutes. Larger inputs
+    // become more runs, and the merge combines them.
+    static constexpr size_t MAX_FORD_JOHNSON_RUN = 1 << 16;
+
+private:
+    // Upper bound on runs merged at once; more runs are merged in passes.
+    static constexpr size_t MAX_FAN_IN = 256;
+
+    size_t memoryBytes_;
+    Algorithm algorithm_;
+    std::vector<int> run_;
+    FordJohnson<std::vector<int> > sorter_;
+    // Descriptors of spilled runs that are still open; closed on destruction
+    // so that an aborted sort does not leak them.
+    std::vector<int> runFds_;
+    size_t runCount_;
+
+    [[nodiscard]] size_t runCapacity() const;
+
+    void sortRun();
+
+    [[nodiscard]] int spillRun() const;
+
+    void mergeGroup(const std::vector<int> &runs, IntWriter &out) const;
+
+    void closeRuns(size_t from, size_t to);
+
+    [[nodiscard]] static int createTempFile();
+
+public:
+    ExternalSort(size_t memoryBytes, Algorithm algorithm);
+
+    ExternalSort(const ExternalSort &other) = delete;
+
+    ExternalSort &operator=(const ExternalSort &other) = delete;
+
+    ~ExternalSort();
+
+    // Writes the sorted contents of in to out and returns the number of elements.
+    size_t sort(IntReader &in, IntWriter &out);
+
+    [[nodiscard]] size_t getRunCount() const;
+};
+
+#endif //EXTERNALSORT_H
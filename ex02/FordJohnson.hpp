@@ -2,20 +2,106 @@
 
 #include <vector>
 #include <utility>
+#include <type_traits>
+#include <cstddef>
+#include <algorithm>
+#include <memory_resource>
 
-template<typename Container>
+#include "SortingNetwork.hpp"
+#include "InsertionSchedule.hpp"
+#include "Instrumentation.hpp"
+
+// How subproblems of at most SortingNetwork::MAX_SIZE elements are sorted.
+// MERGE_INSERTION recurses down to single elements and needs the fewest
+// comparisons, e.g. 7 for n = 5 and 46 for n = 16. SORTING_NETWORK is
+// branch-free and vectorized but uses more comparisons: 12 for n = 5, 63
+// for n = 16, and around 0.2% more overall at n = 1000.
+enum class BaseCase {
+    MERGE_INSERTION,
+    SORTING_NETWORK
+};
+
+// Container may be any sequence of ints. The recursion always runs on a
+// contiguous working copy in the sorter's arena, where indexing and
+// mid-sequence inserts are cheap; the caller's container is read once and
+// its existing elements are overwritten once at the end. A deque thus never
+// pays for random-access inserts, and a list keeps its nodes instead of
+// reallocating them.
+//
+// Every element carries a tag through the recursion. A level tags the
+// larger element of pair j with j before sorting the larger elements, so the
+// sorted order comes back as a permutation of pairs and each pending element
+// is found from its partner without a search, also among equal values.
+//
+// Instrumentation selects what the sorter records about itself; see
+// Instrumentation.hpp. The default records nothing and costs nothing.
+template<typename Container, typename Instrumentation = NoInstrumentation>
 class FordJohnson {
 private:
-    int comparisons_;
+    static_assert(std::is_same_v<typename Container::value_type, int>, "FordJohnson sorts sequences of int");
 
-    static std::vector<int> generateJacobsthal(int n);
+    using Scratch = std::pmr::vector<int>;
+
+    // Forwards to the arena and reports each allocation to the policy.
+    class CountingResource : public std::pmr::memory_resource {
+    private:
+        std::pmr::memory_resource *upstream_;
+        Instrumentation *instrumentation_;
+
+        void *do_allocate(const size_t bytes, const size_t alignment) override {
+            instrumentation_->allocation(bytes);
+            return upstream_->allocate(bytes, alignment);
+        }
 
-    static std::vector<int> getInsertionOrder(int n);
+        void do_deallocate(void *p, const size_t bytes, const size_t alignment) override {
+            upstream_->deallocate(p, bytes, alignment);
+        }
+
+        [[nodiscard]] bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+            return this == &other;
+        }
+
+    public:
+        CountingResource(std::pmr::memory_resource *upstream, Instrumentation *instrumentation)
+            : upstream_(upstream), instrumentation_(instrumentation) {
+        }
+    };
 
-    void binaryInsert(Container &arr, int value, int maxPos);
+    BaseCase baseCase_;
+    Instrumentation instrumentation_;
+    // Where the arena and anything that overflows it come from.
+    std::pmr::memory_resource *upstream_;
+    // Backing storage for the per-sort monotonic arena. It only grows, so
+    // repeated sorts of similar sizes do not touch the heap again, and it is
+    // left uninitialized, so growing it does not write every byte.
+    std::byte *arena_;
+    size_t arenaSize_;
+
+    static size_t arenaBytesFor(size_t n);
+
+    void releaseArena();
+
+    int binaryInsert(Scratch &arr, Scratch &tags, int value, int tag, int maxPos);
+
+    void sortSmall(int *values, int *tags, size_t n);
+
+    void splitPairs(const Scratch &values, const Scratch &tags, size_t count, Scratch &highs, Scratch &lows,
+                    Scratch &highTags, Scratch &lowTags);
+
+    // Sorts values and applies the same permutation to tags.
+    void sortImpl(Scratch &values, Scratch &tags, std::pmr::memory_resource *mem);
 
 public:
-    FordJohnson();
+    // Upper bound on the arena ints one sort needs per element. The working
+    // copy and its tags take 2n; a level of m elements allocates 5m (2m for
+    // the split pairs and their tags, m for the pair permutation and chain
+    // positions, 2m for the chain and its tags), and the levels halve.
+    static constexpr size_t SCRATCH_INTS_PER_ELEMENT = 12;
+
+    // All memory a sort needs beyond the caller's container comes from
+    // upstream.
+    explicit FordJohnson(BaseCase baseCase = BaseCase::MERGE_INSERTION,
+                         std::pmr::memory_resource *upstream = std::pmr::get_default_resource());
 
     FordJohnson(const FordJohnson &other);
 
@@ -25,126 +111,218 @@ public:
 
     Container sort(Container arr);
 
-    [[nodiscard]] int getComparisons() const;
+    // Comparisons made by the last sort; always 0 with NoInstrumentation.
+    [[nodiscard]] unsigned long long getComparisons() const;
+
+    [[nodiscard]] const Instrumentation &getInstrumentation() const;
 };
 
 
-template<typename Container>
-FordJohnson<Container>::FordJohnson() : comparisons_(0) {
+template<typename Container, typename Instrumentation>
+FordJohnson<Container, Instrumentation>::FordJohnson(const BaseCase baseCase, std::pmr::memory_resource *upstream)
+    : baseCase_(baseCase), upstream_(upstream), arena_(nullptr), arenaSize_(0) {
 }
 
-template<typename Container>
-FordJohnson<Container>::FordJohnson(const FordJohnson &other) : comparisons_(other.comparisons_) {
+template<typename Container, typename Instrumentation>
+FordJohnson<Container, Instrumentation>::FordJohnson(const FordJohnson &other)
+    : baseCase_(other.baseCase_), instrumentation_(other.instrumentation_), upstream_(other.upstream_),
+      arena_(nullptr), arenaSize_(0) {
 }
 
-template<typename Container>
-FordJohnson<Container> &FordJohnson<Container>::operator=(const FordJohnson &other) {
+template<typename Container, typename Instrumentation>
+FordJohnson<Container, Instrumentation> &FordJohnson<Container, Instrumentation>::operator=(
+    const FordJohnson &other) {
     if (this != &other) {
-        comparisons_ = other.comparisons_;
+        releaseArena();
+        baseCase_ = other.baseCase_;
+        instrumentation_ = other.instrumentation_;
+        upstream_ = other.upstream_;
     }
     return *this;
 }
 
-template<typename Container>
-FordJohnson<Container>::~FordJohnson() = default;
-
-template<typename Container>
-std::vector<int> FordJohnson<Container>::generateJacobsthal(int n) {
-    std::vector<int> j;
-    j.reserve(64);
-    j.push_back(0);
-    j.push_back(1);
-    while (j.back() < n) {
-        int next = j[j.size() - 1] + 2 * j[j.size() - 2];
-        j.push_back(next);
-    }
-    return j;
+template<typename Container, typename Instrumentation>
+FordJohnson<Container, Instrumentation>::~FordJohnson() {
+    releaseArena();
 }
 
-template<typename Container>
-std::vector<int> FordJohnson<Container>::getInsertionOrder(int n) {
-    std::vector<int> jac = generateJacobsthal(n);
-    std::vector<int> order;
-    order.reserve(n);
-    std::vector<bool> used(n + 1, false);
-    for (size_t i = 2; i < jac.size() && jac[i] <= n; ++i) {
-        const int start = jac[i];
-        const int end = jac[i - 1] + 1;
-        for (int j = start; j >= end && j <= n; --j) {
-            if (!used[j]) {
-                order.push_back(j);
-                used[j] = true;
-            }
-        }
+template<typename Container, typename Instrumentation>
+void FordJohnson<Container, Instrumentation>::releaseArena() {
+    if (arena_) upstream_->deallocate(arena_, arenaSize_, alignof(std::max_align_t));
+    arena_ = nullptr;
+    arenaSize_ = 0;
+}
+
+template<typename Container, typename Instrumentation>
+size_t FordJohnson<Container, Instrumentation>::arenaBytesFor(const size_t n) {
+    // Mirrors the allocations of sort() and sortImpl(). Each allocation may
+    // be padded up to max_align_t; anything beyond the arena falls back to
+    // the heap, so an underestimate costs speed, not correctness.
+    const size_t padding = alignof(std::max_align_t);
+    size_t ints = 2 * n;
+    size_t allocations = 2;
+    for (size_t m = n; m > 1; m /= 2) {
+        const size_t pairs = m / 2;
+        // highs, lows, their tags, pairOf, chain, chain tags, positions.
+        ints += 4 * pairs + pairs + 2 * m + pairs + 3;
+        allocations += 8;
     }
-    for (int i = 1; i <= n; ++i) if (!used[i]) order.push_back(i);
-    return order;
+    return ints * sizeof(int) + allocations * padding;
 }
 
-template<typename Container>
-void FordJohnson<Container>::binaryInsert(Container &arr, int value, int maxPos) {
+template<typename Container, typename Instrumentation>
+int FordJohnson<Container, Instrumentation>::binaryInsert(Scratch &arr, Scratch &tags, const int value,
+                                                          const int tag, const int maxPos) {
     int left = 0;
     int right = maxPos;
     while (left < right) {
         const int mid = left + (right - left) / 2;
-        ++comparisons_;
+        instrumentation_.compare(arr[mid], value);
         if (arr[mid] < value) left = mid + 1;
         else right = mid;
     }
+    instrumentation_.moves(arr.size() - static_cast<size_t>(left) + 1);
     arr.insert(arr.begin() + left, value);
+    tags.insert(tags.begin() + left, tag);
+    return left;
+}
+
+template<typename Container, typename Instrumentation>
+void FordJohnson<Container, Instrumentation>::sortSmall(int *values, int *tags, const size_t n) {
+    instrumentation_.moves(2 * SortingNetwork::comparisons(n));
+    if constexpr (Instrumentation::RECORDS_PAIRS) {
+        SortingNetwork::sortTraced(values, tags, n, [this](const int a, const int b) {
+            instrumentation_.compare(a, b);
+        });
+    } else {
+        instrumentation_.compares(SortingNetwork::comparisons(n));
+        SortingNetwork::sort(values, tags, n);
+    }
 }
 
-template<typename Container>
-Container FordJohnson<Container>::sort(Container arr) {
-    comparisons_ = 0;
+template<typename Container, typename Instrumentation>
+void FordJohnson<Container, Instrumentation>::splitPairs(const Scratch &values, const Scratch &tags,
+                                                        const size_t count, Scratch &highs, Scratch &lows,
+                                                        Scratch &highTags, Scratch &lowTags) {
+    highs.resize(count);
+    lows.resize(count);
+    highTags.resize(count);
+    lowTags.resize(count);
+    instrumentation_.moves(2 * count);
+    if constexpr (Instrumentation::RECORDS_PAIRS) {
+        for (size_t i = 0; i < count; ++i) instrumentation_.compare(values[2 * i], values[2 * i + 1]);
+    } else {
+        instrumentation_.compares(count);
+    }
+    SortingNetwork::pairwiseMinMax(values.data(), tags.data(), count, highs.data(), lows.data(), highTags.data(),
+                                   lowTags.data());
+}
+
+template<typename Container, typename Instrumentation>
+Container FordJohnson<Container, Instrumentation>::sort(Container arr) {
+    instrumentation_.reset();
     const size_t n = arr.size();
     if (n <= 1) return arr;
 
-    std::vector<std::pair<int, int> > pairs;
-    pairs.reserve(n / 2);
-    int straggler = -1;
-    const bool hasStraggler = (n % 2 == 1);
-    if (hasStraggler) straggler = arr[n - 1];
+    const size_t bytes = arenaBytesFor(n);
+    if (arenaSize_ < bytes) {
+        releaseArena();
+        arena_ = static_cast<std::byte *>(upstream_->allocate(bytes, alignof(std::max_align_t)));
+        arenaSize_ = bytes;
+    }
+    std::pmr::monotonic_buffer_resource arena(arena_, arenaSize_, upstream_);
+    CountingResource counted(&arena, &instrumentation_);
+    std::pmr::memory_resource *mem = &arena;
+    if constexpr (Instrumentation::COUNTS_ALLOCATIONS) mem = &counted;
 
-    for (size_t i = 0; i < n - (hasStraggler ? 1 : 0); i += 2) {
-        ++comparisons_;
-        if (arr[i] > arr[i + 1]) pairs.emplace_back(arr[i], arr[i + 1]);
-        else pairs.emplace_back(arr[i + 1], arr[i]);
+    Scratch work(arr.begin(), arr.end(), mem);
+    if (baseCase_ == BaseCase::SORTING_NETWORK && n <= SortingNetwork::MAX_SIZE) {
+        instrumentation_.enterLevel();
+        sortSmall(work.data(), nullptr, n);
+        instrumentation_.leaveLevel();
+    } else {
+        // The caller has no use for the final permutation; the tags only
+        // have to be distinct.
+        Scratch tags(n, mem);
+        for (size_t i = 0; i < n; ++i) tags[i] = static_cast<int>(i);
+        sortImpl(work, tags, mem);
     }
+    std::copy(work.begin(), work.end(), arr.begin());
+    instrumentation_.moves(2 * n);
+    return arr;
+}
 
-    Container larger;
-    larger = Container();
-    for (size_t i = 0; i < pairs.size(); ++i) larger.push_back(pairs[i].first);
-    if (larger.size() > 1) larger = sort(larger);
-
-    std::vector<int> smaller(pairs.size());
-    for (size_t i = 0; i < pairs.size(); ++i) {
-        for (size_t j = 0; j < pairs.size(); ++j) {
-            if (pairs[j].first == larger[i]) {
-                smaller[i] = pairs[j].second;
-                break;
-            }
-        }
+template<typename Container, typename Instrumentation>
+void FordJohnson<Container, Instrumentation>::sortImpl(Scratch &values, Scratch &tags,
+                                                      std::pmr::memory_resource *mem) {
+    const size_t n = values.size();
+    if (n <= 1) return;
+    instrumentation_.enterLevel();
+    if (baseCase_ == BaseCase::SORTING_NETWORK && n <= SortingNetwork::MAX_SIZE) {
+        sortSmall(values.data(), tags.data(), n);
+        instrumentation_.leaveLevel();
+        return;
+    }
+
+    const size_t pairs = n / 2;
+    const bool hasStraggler = (n % 2 == 1);
+
+    // Pair j is (highs[j], lows[j]); highTags and lowTags keep the tags the
+    // caller gave them.
+    Scratch highs(mem);
+    Scratch lows(mem);
+    Scratch highTags(mem);
+    Scratch lowTags(mem);
+    splitPairs(values, tags, pairs, highs, lows, highTags, lowTags);
+
+    // After this, highs is sorted and pairOf[i] is the pair highs[i] came from.
+    Scratch pairOf(pairs, mem);
+    for (size_t j = 0; j < pairs; ++j) pairOf[j] = static_cast<int>(j);
+    sortImpl(highs, pairOf, mem);
+
+    // The main chain starts as the partner of the smallest larger element
+    // followed by all larger elements; original element o + 1 is highs[o].
+    Scratch chain(mem);
+    Scratch chainTags(mem);
+    chain.reserve(n);
+    chainTags.reserve(n);
+    chain.push_back(lows[pairOf[0]]);
+    chainTags.push_back(lowTags[pairOf[0]]);
+    for (size_t i = 0; i < pairs; ++i) {
+        chain.push_back(highs[i]);
+        chainTags.push_back(highTags[pairOf[i]]);
     }
+    instrumentation_.moves(chain.size());
 
-    Container mainChain;
-    if (!smaller.empty()) mainChain.push_back(smaller[0]);
-    for (size_t i = 0; i < larger.size(); ++i) mainChain.push_back(larger[i]);
-
-    if (smaller.size() > 1) {
-        std::vector<int> order = getInsertionOrder(static_cast<int>(smaller.size()) - 1);
-        for (int idx: order) {
-            if (idx < static_cast<int>(smaller.size())) {
-                int maxPos = idx + (idx + 1);
-                if (maxPos > static_cast<int>(mainChain.size())) maxPos = static_cast<int>(mainChain.size());
-                binaryInsert(mainChain, smaller[idx], maxPos);
-            }
+    // Pending element i < pairs is the partner of highs[i] and is searched
+    // for in front of it. The straggler is pending element pairs; its bound
+    // is the end of the chain, which the extra original at pairs + 1 tracks.
+    const int last = static_cast<int>(pairs) - 1 + (hasStraggler ? 1 : 0);
+    if (last >= 1) {
+        ChainPositions positions(pairs + 2, mem);
+        InsertionOrder order(last);
+        int idx;
+        while (order.next(idx)) {
+            const size_t i = static_cast<size_t>(idx);
+            const bool straggler = i == pairs;
+            const int value = straggler ? values[n - 1] : lows[pairOf[i]];
+            const int tag = straggler ? tags[n - 1] : lowTags[pairOf[i]];
+            const int pos = binaryInsert(chain, chainTags, value, tag, positions.position(i + 1));
+            positions.inserted(pos);
         }
     }
 
-    if (hasStraggler) binaryInsert(mainChain, straggler, static_cast<int>(mainChain.size()));
-    return mainChain;
+    values.swap(chain);
+    tags.swap(chainTags);
+    instrumentation_.leaveLevel();
 }
 
-template<typename Container>
-int FordJohnson<Container>::getComparisons() const { return comparisons_; }
+template<typename Container, typename Instrumentation>
+unsigned long long FordJohnson<Container, Instrumentation>::getComparisons() const {
+    return instrumentation_.comparisons();
+}
+
+template<typename Container, typename Instrumentation>
+const Instrumentation &FordJohnson<Container, Instrumentation>::getInstrumentation() const {
+    return instrumentation_;
+}
@@ -0,0 +1,152 @@
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <list>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "FordJohnson.hpp"
+#include "colors.h"
+
+// Regression tests for FordJohnson. Every sort is checked against
+// std::sort, which catches lost or duplicated elements as well as wrong
+// order.
+
+static int g_failures = 0;
+
+template<typename Container, typename Instrumentation>
+static bool sortsLike(const std::vector<int> &input, const BaseCase baseCase = BaseCase::MERGE_INSERTION) {
+    FordJohnson<Container, Instrumentation> sorter(baseCase);
+    const Container sorted = sorter.sort(Container(input.begin(), input.end()));
+    std::vector<int> expected = input;
+    std::sort(expected.begin(), expected.end());
+    return std::vector<int>(sorted.begin(), sorted.end()) == expected;
+}
+
+template<typename Instrumentation>
+static bool sortsLikeEverywhere(const std::vector<int> &input) {
+    return sortsLike<std::vector<int>, Instrumentation>(input)
+           && sortsLike<std::deque<int>, Instrumentation>(input)
+           && sortsLike<std::list<int>, Instrumentation>(input);
+}
+
+static bool sortsCorrectly(const std::vector<int> &input) {
+    // TraceInstrumentation takes the scalar pair split and network, the
+    // others the vectorized ones.
+    return sortsLikeEverywhere<NoInstrumentation>(input)
+           && sortsLikeEverywhere<CountingInstrumentation>(input)
+           && sortsLikeEverywhere<TraceInstrumentation>(input)
+           && sortsLike<std::vector<int>, NoInstrumentation>(input, BaseCase::SORTING_NETWORK)
+           && sortsLike<std::vector<int>, TraceInstrumentation>(input, BaseCase::SORTING_NETWORK);
+}
+
+static void check(const std::string &name, const bool ok) {
+    if (ok) {
+        std::cout << GREEN << "OK " << RESET << name << std::endl;
+    } else {
+        std::cout << RED << "KO " << RESET << name << std::endl;
+        ++g_failures;
+    }
+}
+
+// Equal larger elements with different partners. Matching partners by
+// value used to hand one partner to both pairs, which dropped one element
+// and duplicated another.
+static void testEqualLargerElements() {
+    bool ok = true;
+    for (size_t n = 2; n <= 200 && ok; ++n) {
+        std::vector<int> input;
+        for (size_t i = 0; i < n; ++i) input.push_back(i % 2 == 0 ? 1000 : static_cast<int>(i));
+        ok = sortsCorrectly(input);
+    }
+    check("equal larger elements keep their own partners", ok);
+
+    std::mt19937 rng(1);
+    ok = true;
+    for (int round = 0; round < 300 && ok; ++round) {
+        std::vector<int> input(1 + rng() % 400);
+        for (int &v: input) v = static_cast<int>(rng() % 4);
+        ok = sortsCorrectly(input);
+    }
+    check("few distinct values", ok);
+
+    check("all equal", sortsCorrectly(std::vector<int>(333, 7)));
+}
+
+// Random inputs of every size up to a few recursion levels. A pending
+// element bounded by a stale partner position used to be inserted too far
+// to the left.
+static void testInsertionBounds() {
+    std::mt19937 rng(2);
+    bool ok = true;
+    for (size_t n = 0; n <= 600 && ok; ++n) {
+        for (int round = 0; round < 3 && ok; ++round) {
+            std::vector<int> input(n);
+            for (int &v: input) v = static_cast<int>(rng() % 100000) - 50000;
+            ok = sortsCorrectly(input);
+        }
+    }
+    check("random inputs of sizes 0 to 600", ok);
+
+    std::vector<int> extremes;
+    for (int i = 0; i < 101; ++i) extremes.push_back(i % 3 == 0 ? INT_MIN : i % 3 == 1 ? INT_MAX : -i);
+    check("INT_MIN and INT_MAX", sortsCorrectly(extremes));
+
+    std::vector<int> large(50000);
+    for (int &v: large) v = static_cast<int>(rng());
+    check("random input of 50000 elements", sortsLike<std::vector<int>, NoInstrumentation>(large));
+}
+
+static void testOrderedInputs() {
+    bool ok = true;
+    for (size_t n = 0; n <= 300 && ok; ++n) {
+        std::vector<int> ascending(n);
+        for (size_t i = 0; i < n; ++i) ascending[i] = static_cast<int>(i);
+        std::vector<int> descending(ascending.rbegin(), ascending.rend());
+        ok = sortsCorrectly(ascending) && sortsCorrectly(descending);
+    }
+    check("sorted and reversed inputs", ok);
+}
+
+// Merge-insertion never needs more than F(n) = sum of ceil(log2(3k / 4))
+// for k = 1..n comparisons. Small subproblems must not fall back to
+// anything that needs more.
+static void testComparisonBound() {
+    std::mt19937 rng(3);
+    bool ok = true;
+    long long bound = 0;
+    for (int n = 1; n <= 64 && ok; ++n) {
+        bound += static_cast<long long>(std::ceil(std::log2(3.0 * n / 4.0) - 1e-9));
+        std::vector<int> input(static_cast<size_t>(n));
+        std::iota(input.begin(), input.end(), 0);
+        for (int round = 0; round < 100 && ok; ++round) {
+            std::shuffle(input.begin(), input.end(), rng);
+            FordJohnson<std::vector<int>, CountingInstrumentation> sorter;
+            const std::vector<int> sorted = sorter.sort(input);
+            if (static_cast<long long>(sorter.getComparisons()) > bound) {
+                std::cout << "  n=" << n << ": " << sorter.getComparisons() << " comparisons, bound " << bound
+                        << std::endl;
+                ok = false;
+            }
+        }
+    }
+    check("at most F(n) comparisons for n up to 64", ok);
+}
+
+int main() {
+    testEqualLargerElements();
+    testInsertionBounds();
+    testOrderedInputs();
+    testComparisonBound();
+    if (g_failures > 0) {
+        std::cout << RED << g_failures << " test(s) failed" << RESET << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << GREEN << "All tests passed" << RESET << std::endl;
+    return EXIT_SUCCESS;
+}
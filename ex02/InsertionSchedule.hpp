@@ -0,0 +1,150 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+
+// Jacobsthal numbers J(k) = J(k - 1) + 2 * J(k - 2), up to the first one
+// that no longer fits an int.
+constexpr size_t JACOBSTHAL_SIZE = 34;
+
+constexpr std::array<long long, JACOBSTHAL_SIZE> buildJacobsthal() {
+    std::array<long long, JACOBSTHAL_SIZE> j{};
+    j[0] = 0;
+    j[1] = 1;
+    for (size_t i = 2; i < JACOBSTHAL_SIZE; ++i) j[i] = j[i - 1] + 2 * j[i - 2];
+    return j;
+}
+
+inline constexpr std::array<long long, JACOBSTHAL_SIZE> JACOBSTHAL = buildJacobsthal();
+
+static_assert(JACOBSTHAL[JACOBSTHAL_SIZE - 1] > 0x7fffffff, "table must cover every int index");
+
+// Yields the Ford-Johnson insertion order for the pending elements 1..last
+// (element 0 is placed without comparisons). Elements are inserted in
+// groups bounded by consecutive Jacobsthal numbers, each group from its
+// highest index downwards, so every binary search runs on a chain of
+// 2^k - 1 elements. Nothing is allocated; the state is a few ints.
+class InsertionOrder {
+private:
+    int last_;
+    size_t group_;
+    long long current_;
+    long long groupEnd_;
+
+public:
+    explicit InsertionOrder(int last);
+
+    InsertionOrder(const InsertionOrder &other);
+
+    InsertionOrder &operator=(const InsertionOrder &other);
+
+    ~InsertionOrder();
+
+    bool next(int &idx);
+};
+
+inline InsertionOrder::InsertionOrder(const int last) : last_(last), group_(2), current_(0), groupEnd_(1) {
+}
+
+inline InsertionOrder::InsertionOrder(const InsertionOrder &other) : last_(other.last_), group_(other.group_),
+                                                                     current_(other.current_),
+                                                                     groupEnd_(other.groupEnd_) {
+}
+
+inline InsertionOrder &InsertionOrder::operator=(const InsertionOrder &other) {
+    if (this != &other) {
+        last_ = other.last_;
+        group_ = other.group_;
+        current_ = other.current_;
+        groupEnd_ = other.groupEnd_;
+    }
+    return *this;
+}
+
+inline InsertionOrder::~InsertionOrder() = default;
+
+inline bool InsertionOrder::next(int &idx) {
+    if (current_ < groupEnd_) {
+        ++group_;
+        if (group_ >= JACOBSTHAL_SIZE || JACOBSTHAL[group_ - 1] > last_) return false;
+        groupEnd_ = JACOBSTHAL[group_ - 1];
+        current_ = JACOBSTHAL[group_] - 1;
+        if (current_ > last_) current_ = last_;
+    }
+    idx = static_cast<int>(current_--);
+    return true;
+}
+
+// Tracks where the elements a main chain started with currently are while
+// pending elements are inserted into it, in O(log n) per step instead of
+// rescanning every position after each insert. Original element o sits at
+// o plus the number of inserted elements in front of it; inserted elements
+// are counted per gap (gap g lies right before original g) in a Fenwick tree
+// that also holds a 1 for every original.
+class ChainPositions {
+private:
+    // 1-based Fenwick tree over the gaps.
+    std::pmr::vector<int> tree_;
+    size_t topStep_;
+
+public:
+    ChainPositions(size_t originals, std::pmr::memory_resource *mem);
+
+    ChainPositions(const ChainPositions &other);
+
+    ChainPositions &operator=(const ChainPositions &other);
+
+    ~ChainPositions();
+
+    // Current index of original element o.
+    [[nodiscard]] int position(size_t original) const;
+
+    // Records an element inserted at index pos of the chain.
+    void inserted(int pos);
+};
+
+inline ChainPositions::ChainPositions(const size_t originals, std::pmr::memory_resource *mem)
+    : tree_(originals + 1, 0, mem), topStep_(1) {
+    for (size_t i = 1; i <= originals; ++i) {
+        tree_[i] += 1;
+        const size_t parent = i + (i & (~i + 1));
+        if (parent <= originals) tree_[parent] += tree_[i];
+    }
+    while (topStep_ * 2 <= originals) topStep_ *= 2;
+}
+
+inline ChainPositions::ChainPositions(const ChainPositions &other) : tree_(other.tree_), topStep_(other.topStep_) {
+}
+
+inline ChainPositions &ChainPositions::operator=(const ChainPositions &other) {
+    if (this != &other) {
+        tree_ = other.tree_;
+        topStep_ = other.topStep_;
+    }
+    return *this;
+}
+
+inline ChainPositions::~ChainPositions() = default;
+
+inline int ChainPositions::position(const size_t original) const {
+    int sum = 0;
+    for (size_t i = original + 1; i > 0; i -= i & (~i + 1)) sum += tree_[i];
+    return sum - 1;
+}
+
+inline void ChainPositions::inserted(const int pos) {
+    // The originals in front of pos are the longest prefix of gaps whose
+    // weight does not exceed pos; the new element lies in the gap after them.
+    const size_t size = tree_.size() - 1;
+    size_t gap = 0;
+    int remaining = pos;
+    for (size_t step = topStep_; step > 0; step >>= 1) {
+        if (gap + step <= size && tree_[gap + step] <= remaining) {
+            gap += step;
+            remaining -= tree_[gap];
+        }
+    }
+    for (size_t i = gap + 1; i <= size; i += i & (~i + 1)) ++tree_[i];
+}
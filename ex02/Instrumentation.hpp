@@ -0,0 +1,159 @@
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+// Instrumentation policies for FordJohnson. The sorter reports every
+// comparison, element write, scratch allocation and recursion level to its
+// policy; which of those are kept is up to the policy.
+//
+// Policies provide:
+//   RECORDS_PAIRS      - true if compare() needs the actual operands; the
+//                        sorter then avoids the SIMD kernels, which compare
+//                        many pairs at once
+//   COUNTS_ALLOCATIONS - true if allocation() should be called
+//   reset()            - called at the start of every sort
+//   enterLevel() / leaveLevel()
+//   compare(a, b)      - one comparison between a and b
+//   compares(count)    - count comparisons whose operands are not recorded
+//   moves(count)       - count element writes
+//   allocation(bytes)  - one scratch allocation
+
+// Does nothing; every hook is an empty inline function, so the default
+// sorter compiles to the same code as an uninstrumented one.
+class NoInstrumentation {
+public:
+    static constexpr bool RECORDS_PAIRS = false;
+    static constexpr bool COUNTS_ALLOCATIONS = false;
+
+    void reset() {}
+
+    void enterLevel() {}
+
+    void leaveLevel() {}
+
+    void compare(int, int) {}
+
+    void compares(size_t) {}
+
+    void moves(size_t) {}
+
+    void allocation(size_t) {}
+
+    [[nodiscard]] unsigned long long comparisons() const { return 0; }
+};
+
+// 64-bit totals plus the same counters per recursion level (level 0 is the
+// outermost call).
+class CountingInstrumentation {
+public:
+    struct Counters {
+        unsigned long long comparisons = 0;
+        unsigned long long moves = 0;
+        unsigned long long allocations = 0;
+        unsigned long long allocatedBytes = 0;
+    };
+
+    static constexpr bool RECORDS_PAIRS = false;
+    static constexpr bool COUNTS_ALLOCATIONS = true;
+
+protected:
+    Counters total_;
+    std::vector<Counters> levels_;
+    // Number of enclosing enterLevel() calls; work outside of any level is
+    // attributed to level 0.
+    size_t depth_;
+
+    [[nodiscard]] size_t level() const { return depth_ > 0 ? depth_ - 1 : 0; }
+
+    Counters &current() {
+        if (levels_.size() <= level()) levels_.resize(level() + 1);
+        return levels_[level()];
+    }
+
+public:
+    CountingInstrumentation() : depth_(0) {}
+
+    void reset() {
+        total_ = Counters();
+        levels_.clear();
+        depth_ = 0;
+    }
+
+    void enterLevel() { ++depth_; }
+
+    void leaveLevel() {
+        if (depth_ > 0) --depth_;
+    }
+
+    void compare(int, int) { compares(1); }
+
+    void compares(const size_t count) {
+        total_.comparisons += count;
+        current().comparisons += count;
+    }
+
+    void moves(const size_t count) {
+        total_.moves += count;
+        current().moves += count;
+    }
+
+    void allocation(const size_t bytes) {
+        ++total_.allocations;
+        total_.allocatedBytes += bytes;
+        ++current().allocations;
+        current().allocatedBytes += bytes;
+    }
+
+    [[nodiscard]] unsigned long long comparisons() const { return total_.comparisons; }
+
+    [[nodiscard]] const Counters &total() const { return total_; }
+
+    [[nodiscard]] const std::vector<Counters> &levels() const { return levels_; }
+
+    void report(std::ostream &out) const {
+        out << "level,comparisons,moves,allocations,allocated_bytes\n";
+        for (size_t i = 0; i < levels_.size(); ++i) {
+            out << i << ',' << levels_[i].comparisons << ',' << levels_[i].moves << ','
+                    << levels_[i].allocations << ',' << levels_[i].allocatedBytes << '\n';
+        }
+        out << "total," << total_.comparisons << ',' << total_.moves << ','
+                << total_.allocations << ',' << total_.allocatedBytes << '\n';
+    }
+};
+
+// Counts like CountingInstrumentation and additionally records every
+// comparison with its operands and level, for offline analysis.
+class TraceInstrumentation : public CountingInstrumentation {
+public:
+    struct Entry {
+        size_t level;
+        int a;
+        int b;
+    };
+
+    static constexpr bool RECORDS_PAIRS = true;
+
+private:
+    std::vector<Entry> trace_;
+
+public:
+    void reset() {
+        CountingInstrumentation::reset();
+        trace_.clear();
+    }
+
+    void compare(const int a, const int b) {
+        trace_.push_back(Entry{level(), a, b});
+        compares(1);
+    }
+
+    [[nodiscard]] const std::vector<Entry> &trace() const { return trace_; }
+
+    // One "level a b" line per comparison, in the order they were made.
+    void dump(std::ostream &out) const {
+        for (const Entry &e: trace_) out << e.level << ' ' << e.a << ' ' << e.b << '\n';
+    }
+};
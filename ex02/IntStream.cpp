@@ -0,0 +1,207 @@
+#include "IntStream.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static std::string errnoMessage(const std::string &what) {
+    return what + ": " + std::strerror(errno);
+}
+
+static bool isSpace(const char c) {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+IntReader::IntReader(const std::string &path, const IntFormat format)
+    : fd_(STDIN_FILENO), ownsFd_(false), format_(format), map_(nullptr), mapSize_(0),
+      data_(nullptr), pos_(0), end_(0), eof_(false) {
+    if (path != "-") {
+        fd_ = open(path.c_str(), O_RDONLY);
+        if (fd_ < 0) throw std::runtime_error(errnoMessage("cannot open " + path));
+        ownsFd_ = true;
+    }
+
+    struct stat st{};
+    if (fstat(fd_, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void *map = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd_, 0);
+        if (map != MAP_FAILED) {
+            madvise(map, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+            map_ = map;
+            mapSize_ = static_cast<size_t>(st.st_size);
+            data_ = static_cast<const char *>(map_);
+            end_ = mapSize_;
+            eof_ = true;
+            return;
+        }
+    }
+    buffer_.resize(DEFAULT_BUFFER_SIZE);
+    data_ = buffer_.data();
+}
+
+IntReader::IntReader(const int fd, const IntFormat format, const size_t bufferSize)
+    : fd_(fd), ownsFd_(false), format_(format), map_(nullptr), mapSize_(0), buffer_(bufferSize),
+      data_(buffer_.data()), pos_(0), end_(0), eof_(false) {
+}
+
+IntReader::~IntReader() {
+    if (map_) munmap(map_, mapSize_);
+    if (ownsFd_) close(fd_);
+}
+
+// Moves the unconsumed tail to the front of the buffer and reads more
+// behind it. Returns false once no further bytes can arrive.
+bool IntReader::refill() {
+    if (eof_) return false;
+    const size_t left = end_ - pos_;
+    if (left > 0 && pos_ > 0) std::memmove(buffer_.data(), buffer_.data() + pos_, left);
+    pos_ = 0;
+    end_ = left;
+    if (end_ == buffer_.size()) throw std::runtime_error("token longer than the read buffer");
+    while (true) {
+        const ssize_t got = ::read(fd_, buffer_.data() + end_, buffer_.size() - end_);
+        if (got < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error(errnoMessage("read failed"));
+        }
+        if (got == 0) eof_ = true;
+        end_ += static_cast<size_t>(got);
+        return got > 0;
+    }
+}
+
+size_t IntReader::readText(int *out, const size_t max) {
+    size_t count = 0;
+    while (count < max) {
+        while (pos_ < end_ && isSpace(data_[pos_])) ++pos_;
+        if (pos_ == end_) {
+            if (!refill()) break;
+            continue;
+        }
+
+        size_t tokenEnd = pos_;
+        while (tokenEnd < end_ && !isSpace(data_[tokenEnd])) ++tokenEnd;
+        if (tokenEnd == end_ && !eof_) {
+            refill();
+            continue;
+        }
+
+        size_t i = pos_;
+        if (data_[i] == '+') ++i;
+        long long value = 0;
+        bool valid = i < tokenEnd;
+        for (; i < tokenEnd && valid; ++i) {
+            if (data_[i] < '0' || data_[i] > '9') valid = false;
+            else value = value * 10 + (data_[i] - '0');
+            if (value > INT_MAX) valid = false;
+        }
+        if (!valid || value <= 0)
+            throw std::runtime_error("invalid number '" + std::string(data_ + pos_, tokenEnd - pos_) + "'");
+        out[count++] = static_cast<int>(value);
+        pos_ = tokenEnd;
+    }
+    return count;
+}
+
+size_t IntReader::readBinary(int *out, const size_t max) {
+    size_t count = 0;
+    while (count < max) {
+        size_t available = (end_ - pos_) / sizeof(int);
+        if (available == 0) {
+            if (refill()) continue;
+            if (end_ != pos_) throw std::runtime_error("truncated binary input");
+            break;
+        }
+        if (available > max - count) available = max - count;
+        std::memcpy(out + count, data_ + pos_, available * sizeof(int));
+        for (size_t i = 0; i < available; ++i) {
+            if (out[count + i] <= 0)
+                throw std::runtime_error("invalid number " + std::to_string(out[count + i]));
+        }
+        pos_ += available * sizeof(int);
+        count += available;
+    }
+    return count;
+}
+
+size_t IntReader::read(int *out, const size_t max) {
+    if (format_ == IntFormat::BINARY) return readBinary(out, max);
+    return readText(out, max);
+}
+
+IntWriter::IntWriter(const std::string &path, const IntFormat format)
+    : fd_(STDOUT_FILENO), ownsFd_(false), format_(format), buffer_(DEFAULT_BUFFER_SIZE), used_(0) {
+    if (path != "-") {
+        fd_ = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd_ < 0) throw std::runtime_error(errnoMessage("cannot open " + path));
+        ownsFd_ = true;
+    }
+}
+
+IntWriter::IntWriter(const int fd, const IntFormat format, const size_t bufferSize)
+    : fd_(fd), ownsFd_(false), format_(format), buffer_(bufferSize), used_(0) {
+}
+
+IntWriter::~IntWriter() {
+    try {
+        flush();
+    } catch (const std::exception &) {
+    }
+    if (ownsFd_) close(fd_);
+}
+
+void IntWriter::writeAll(const char *data, size_t size) {
+    while (size > 0) {
+        const ssize_t put = ::write(fd_, data, size);
+        if (put < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error(errnoMessage("write failed"));
+        }
+        data += put;
+        size -= static_cast<size_t>(put);
+    }
+}
+
+void IntWriter::write(const int *values, const size_t count) {
+    if (format_ == IntFormat::BINARY) {
+        const char *bytes = reinterpret_cast<const char *>(values);
+        size_t left = count * sizeof(int);
+        while (left > 0) {
+            if (used_ == buffer_.size()) flush();
+            const size_t chunk = std::min(left, buffer_.size() - used_);
+            std::memcpy(buffer_.data() + used_, bytes, chunk);
+            used_ += chunk;
+            bytes += chunk;
+            left -= chunk;
+        }
+        return;
+    }
+
+    // Longest line is INT_MAX plus the newline.
+    constexpr size_t MAX_LINE = 11;
+    for (size_t i = 0; i < count; ++i) {
+        if (buffer_.size() - used_ < MAX_LINE) flush();
+        char digits[MAX_LINE];
+        size_t n = 0;
+        unsigned int v = static_cast<unsigned int>(values[i]);
+        do {
+            digits[n++] = static_cast<char>('0' + v % 10);
+            v /= 10;
+        } while (v > 0);
+        while (n > 0) buffer_[used_++] = digits[--n];
+        buffer_[used_++] = '\n';
+    }
+}
+
+void IntWriter::flush() {
+    if (used_ == 0) return;
+    const size_t size = used_;
+    used_ = 0;
+    writeAll(buffer_.data(), size);
+}
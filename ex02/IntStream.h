@@ -0,0 +1,85 @@
+#ifndef INTSTREAM_H
+#define INTSTREAM_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Positive integers as either whitespace separated decimal text or raw
+// native-endian 32-bit ints.
+enum class IntFormat {
+    TEXT,
+    BINARY
+};
+
+// Reads positive integers from a file or stdin ("-"). Regular files are
+// mapped into memory; pipes, terminals and run files are read through a
+// fixed-size buffer. Malformed input throws std::runtime_error.
+class IntReader {
+private:
+    int fd_;
+    bool ownsFd_;
+    IntFormat format_;
+    void *map_;
+    size_t mapSize_;
+    std::vector<char> buffer_;
+    const char *data_;
+    size_t pos_;
+    size_t end_;
+    bool eof_;
+
+    bool refill();
+
+    size_t readText(int *out, size_t max);
+
+    size_t readBinary(int *out, size_t max);
+
+public:
+    static constexpr size_t DEFAULT_BUFFER_SIZE = 1 << 20;
+
+    IntReader(const std::string &path, IntFormat format);
+
+    // Reads from an already open descriptor at its current offset without
+    // taking ownership of it.
+    IntReader(int fd, IntFormat format, size_t bufferSize = DEFAULT_BUFFER_SIZE);
+
+    IntReader(const IntReader &other) = delete;
+
+    IntReader &operator=(const IntReader &other) = delete;
+
+    ~IntReader();
+
+    // Fills out with up to max values and returns how many were read; 0 means end of input.
+    [[nodiscard]] size_t read(int *out, size_t max);
+};
+
+// Buffers integers and hands them to the kernel in large writes.
+class IntWriter {
+private:
+    int fd_;
+    bool ownsFd_;
+    IntFormat format_;
+    std::vector<char> buffer_;
+    size_t used_;
+
+    void writeAll(const char *data, size_t size);
+
+public:
+    static constexpr size_t DEFAULT_BUFFER_SIZE = 1 << 20;
+
+    IntWriter(const std::string &path, IntFormat format);
+
+    IntWriter(int fd, IntFormat format, size_t bufferSize = DEFAULT_BUFFER_SIZE);
+
+    IntWriter(const IntWriter &other) = delete;
+
+    IntWriter &operator=(const IntWriter &other) = delete;
+
+    ~IntWriter();
+
+    void write(const int *values, size_t count);
+
+    void flush();
+};
+
+#endif //INTSTREAM_H
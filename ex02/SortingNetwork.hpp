@@ -0,0 +1,285 @@
+#pragma once
+
+#include <array>
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
+
+// Branch-free sorting networks for the tiny subproblems at the bottom of the
+// Ford-Johnson recursion, used when FordJohnson is built with
+// BaseCase::SORTING_NETWORK. The network is Batcher's odd-even merge sort on
+// MAX_SIZE wires, built at compile time; shorter inputs use the same network
+// with every comparator touching a wire >= n pruned away. That trades
+// comparisons for speed: a pruned Batcher network is neither optimal for its
+// size nor close to merge-insertion (63 comparators for 16 elements, where
+// merge-insertion needs at most 46). pairwiseMinMax, which splits each level
+// of the recursion into pairs and their tags, is used with either base case.
+namespace SortingNetwork {
+    constexpr size_t MAX_SIZE = 16;
+
+    struct Comparator {
+        unsigned char lo;
+        unsigned char hi;
+    };
+
+    constexpr size_t countComparators(const size_t wires, size_t *layers = nullptr) {
+        size_t count = 0;
+        size_t layer = 0;
+        for (size_t p = 1; p < wires; p <<= 1) {
+            for (size_t k = p; k >= 1; k >>= 1, ++layer) {
+                for (size_t j = k % p; j + k < wires; j += 2 * k) {
+                    for (size_t i = 0; i < k && i + j + k < wires; ++i) {
+                        if ((i + j) / (2 * p) == (i + j + k) / (2 * p)) ++count;
+                    }
+                }
+            }
+        }
+        if (layers) *layers = layer;
+        return count;
+    }
+
+    constexpr size_t countLayers(const size_t wires) {
+        size_t layers = 0;
+        countComparators(wires, &layers);
+        return layers;
+    }
+
+    constexpr size_t COMPARATORS = countComparators(MAX_SIZE);
+    constexpr size_t LAYERS = countLayers(MAX_SIZE);
+
+    struct Network {
+        std::array<Comparator, COMPARATORS> comparators;
+        // comparators[layerStart[l], layerStart[l + 1]) are disjoint and form layer l.
+        std::array<size_t, LAYERS + 1> layerStart;
+        // prunedCount[n] is the number of comparators left when sorting n elements.
+        std::array<size_t, MAX_SIZE + 1> prunedCount;
+    };
+
+    constexpr Network buildNetwork() {
+        Network net{};
+        size_t c = 0;
+        size_t layer = 0;
+        for (size_t p = 1; p < MAX_SIZE; p <<= 1) {
+            for (size_t k = p; k >= 1; k >>= 1) {
+                net.layerStart[layer++] = c;
+                for (size_t j = k % p; j + k < MAX_SIZE; j += 2 * k) {
+                    for (size_t i = 0; i < k && i + j + k < MAX_SIZE; ++i) {
+                        if ((i + j) / (2 * p) == (i + j + k) / (2 * p)) {
+                            net.comparators[c].lo = static_cast<unsigned char>(i + j);
+                            net.comparators[c].hi = static_cast<unsigned char>(i + j + k);
+                            ++c;
+                        }
+                    }
+                }
+            }
+        }
+        net.layerStart[layer] = c;
+        for (size_t n = 0; n <= MAX_SIZE; ++n) {
+            size_t kept = 0;
+            for (size_t i = 0; i < c; ++i) if (net.comparators[i].hi < n) ++kept;
+            net.prunedCount[n] = kept;
+        }
+        return net;
+    }
+
+    inline constexpr Network NETWORK = buildNetwork();
+
+    // Number of comparisons performed when sorting n <= MAX_SIZE elements.
+    constexpr size_t comparisons(const size_t n) { return NETWORK.prunedCount[n]; }
+
+    // Scalar network that hands every comparator's operands to onCompare(a, b).
+    // tags[i] travels with data[i]; it may be null when there are none.
+    template<typename OnCompare>
+    inline void sortTraced(int *data, int *tags, const size_t n, OnCompare &&onCompare) {
+        for (size_t c = 0; c < COMPARATORS; ++c) {
+            const Comparator &cmp = NETWORK.comparators[c];
+            if (cmp.hi >= n) continue;
+            const int a = data[cmp.lo];
+            const int b = data[cmp.hi];
+            onCompare(a, b);
+            const bool swap = b < a;
+            data[cmp.lo] = swap ? b : a;
+            data[cmp.hi] = swap ? a : b;
+            if (tags) {
+                const int ta = tags[cmp.lo];
+                const int tb = tags[cmp.hi];
+                tags[cmp.lo] = swap ? tb : ta;
+                tags[cmp.hi] = swap ? ta : tb;
+            }
+        }
+    }
+
+    inline void sortScalar(int *data, int *tags, const size_t n) {
+        sortTraced(data, tags, n, [](int, int) {
+        });
+    }
+
+#if defined(__AVX2__)
+    static_assert(MAX_SIZE == 16, "the AVX2 network keeps exactly two 8-lane registers");
+
+    // Per layer: the partner wire of every wire and whether it keeps the min.
+    struct LayerTables {
+        alignas(32) int partner[LAYERS][MAX_SIZE];
+        alignas(32) int takeMin[LAYERS][MAX_SIZE];
+    };
+
+    constexpr LayerTables buildLayerTables() {
+        LayerTables t{};
+        for (size_t l = 0; l < LAYERS; ++l) {
+            for (size_t w = 0; w < MAX_SIZE; ++w) {
+                t.partner[l][w] = static_cast<int>(w);
+                t.takeMin[l][w] = 0;
+            }
+            for (size_t c = NETWORK.layerStart[l]; c < NETWORK.layerStart[l + 1]; ++c) {
+                t.partner[l][NETWORK.comparators[c].lo] = NETWORK.comparators[c].hi;
+                t.partner[l][NETWORK.comparators[c].hi] = NETWORK.comparators[c].lo;
+                t.takeMin[l][NETWORK.comparators[c].lo] = -1;
+            }
+        }
+        return t;
+    }
+
+    inline constexpr LayerTables LAYER_TABLES = buildLayerTables();
+
+    // Gathers wire partner[w] for each lane w of one half out of the two registers.
+    inline __m256i gather16(const __m256i lo, const __m256i hi, const __m256i partner) {
+        const __m256i fromLo = _mm256_permutevar8x32_epi32(lo, partner);
+        const __m256i fromHi = _mm256_permutevar8x32_epi32(hi, partner);
+        const __m256i useHi = _mm256_cmpgt_epi32(partner, _mm256_set1_epi32(7));
+        return _mm256_blendv_epi8(fromLo, fromHi, useHi);
+    }
+
+    // Which lanes of one register take their partner's value: the lane
+    // keeping the min takes a strictly smaller partner, the other lane a
+    // strictly larger one, so both lanes of a comparator swap or neither.
+    inline __m256i takesPartner(const __m256i own, const __m256i other, const __m256i takeMin) {
+        return _mm256_blendv_epi8(_mm256_cmpgt_epi32(other, own), _mm256_cmpgt_epi32(own, other), takeMin);
+    }
+
+    // The scalar network's comparators, one layer at a time: every lane
+    // fetches its partner wire and the value and tag registers take it
+    // under the same mask. tags may be null. Wires >= n hold INT_MAX, which
+    // no comparator moves down past a real element since nothing is larger,
+    // so padding tags stay at the end.
+    inline void sortAvx2(int *data, int *tags, const size_t n) {
+        alignas(32) int buf[MAX_SIZE];
+        alignas(32) int tagBuf[MAX_SIZE];
+        for (size_t i = 0; i < MAX_SIZE; ++i) {
+            buf[i] = i < n ? data[i] : INT_MAX;
+            tagBuf[i] = i < n && tags ? tags[i] : 0;
+        }
+        __m256i lo = _mm256_load_si256(reinterpret_cast<const __m256i *>(buf));
+        __m256i hi = _mm256_load_si256(reinterpret_cast<const __m256i *>(buf + 8));
+        __m256i tLo = _mm256_load_si256(reinterpret_cast<const __m256i *>(tagBuf));
+        __m256i tHi = _mm256_load_si256(reinterpret_cast<const __m256i *>(tagBuf + 8));
+        for (size_t l = 0; l < LAYERS; ++l) {
+            const int *partner = LAYER_TABLES.partner[l];
+            const int *takeMin = LAYER_TABLES.takeMin[l];
+            const __m256i pLo = _mm256_load_si256(reinterpret_cast<const __m256i *>(partner));
+            const __m256i pHi = _mm256_load_si256(reinterpret_cast<const __m256i *>(partner + 8));
+            const __m256i mLo = _mm256_load_si256(reinterpret_cast<const __m256i *>(takeMin));
+            const __m256i mHi = _mm256_load_si256(reinterpret_cast<const __m256i *>(takeMin + 8));
+            const __m256i oLo = gather16(lo, hi, pLo);
+            const __m256i oHi = gather16(lo, hi, pHi);
+            const __m256i takeLo = takesPartner(lo, oLo, mLo);
+            const __m256i takeHi = takesPartner(hi, oHi, mHi);
+            const __m256i otLo = gather16(tLo, tHi, pLo);
+            const __m256i otHi = gather16(tLo, tHi, pHi);
+            lo = _mm256_blendv_epi8(lo, oLo, takeLo);
+            hi = _mm256_blendv_epi8(hi, oHi, takeHi);
+            tLo = _mm256_blendv_epi8(tLo, otLo, takeLo);
+            tHi = _mm256_blendv_epi8(tHi, otHi, takeHi);
+        }
+        _mm256_store_si256(reinterpret_cast<__m256i *>(buf), lo);
+        _mm256_store_si256(reinterpret_cast<__m256i *>(buf + 8), hi);
+        _mm256_store_si256(reinterpret_cast<__m256i *>(tagBuf), tLo);
+        _mm256_store_si256(reinterpret_cast<__m256i *>(tagBuf + 8), tHi);
+        for (size_t i = 0; i < n; ++i) data[i] = buf[i];
+        if (tags) for (size_t i = 0; i < n; ++i) tags[i] = tagBuf[i];
+    }
+#endif
+
+    // Sorts data[0, n) in place and applies the same permutation to
+    // tags[0, n), which may be null; n must not exceed MAX_SIZE.
+    inline void sort(int *data, int *tags, const size_t n) {
+        if (n <= 1) return;
+#if defined(__AVX2__)
+        sortAvx2(data, tags, n);
+#else
+        sortScalar(data, tags, n);
+#endif
+    }
+
+    // Splits count adjacent pairs of in into their larger and smaller halves:
+    // larger[i] = max(in[2i], in[2i + 1]), smaller[i] = min(in[2i], in[2i + 1]).
+    // Each tag follows its value; of two equal values, in[2i + 1] counts as
+    // the larger one.
+    inline void pairwiseMinMax(const int *in, const int *inTags, const size_t count, int *larger, int *smaller,
+                               int *largerTags, int *smallerTags) {
+        size_t i = 0;
+#if defined(__AVX2__)
+        const auto evensOf = [](const __m256i a, const __m256i b) {
+            return _mm256_permute4x64_epi64(_mm256_castps_si256(_mm256_shuffle_ps(
+                _mm256_castsi256_ps(a), _mm256_castsi256_ps(b), _MM_SHUFFLE(2, 0, 2, 0))), _MM_SHUFFLE(3, 1, 2, 0));
+        };
+        const auto oddsOf = [](const __m256i a, const __m256i b) {
+            return _mm256_permute4x64_epi64(_mm256_castps_si256(_mm256_shuffle_ps(
+                _mm256_castsi256_ps(a), _mm256_castsi256_ps(b), _MM_SHUFFLE(3, 1, 3, 1))), _MM_SHUFFLE(3, 1, 2, 0));
+        };
+        for (; i + 8 <= count; i += 8) {
+            const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + 2 * i));
+            const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + 2 * i + 8));
+            const __m256i ta = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(inTags + 2 * i));
+            const __m256i tb = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(inTags + 2 * i + 8));
+            const __m256i evens = evensOf(a, b);
+            const __m256i odds = oddsOf(a, b);
+            const __m256i evenTags = evensOf(ta, tb);
+            const __m256i oddTags = oddsOf(ta, tb);
+            const __m256i firstHigher = _mm256_cmpgt_epi32(evens, odds);
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(larger + i), _mm256_max_epi32(evens, odds));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(smaller + i), _mm256_min_epi32(evens, odds));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(largerTags + i),
+                                _mm256_blendv_epi8(oddTags, evenTags, firstHigher));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(smallerTags + i),
+                                _mm256_blendv_epi8(evenTags, oddTags, firstHigher));
+        }
+#endif
+#if defined(__SSE4_1__)
+        const auto evensOf4 = [](const __m128i a, const __m128i b) {
+            return _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b), _MM_SHUFFLE(2, 0, 2, 0)));
+        };
+        const auto oddsOf4 = [](const __m128i a, const __m128i b) {
+            return _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b), _MM_SHUFFLE(3, 1, 3, 1)));
+        };
+        for (; i + 4 <= count; i += 4) {
+            const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + 2 * i));
+            const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + 2 * i + 4));
+            const __m128i ta = _mm_loadu_si128(reinterpret_cast<const __m128i *>(inTags + 2 * i));
+            const __m128i tb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(inTags + 2 * i + 4));
+            const __m128i evens = evensOf4(a, b);
+            const __m128i odds = oddsOf4(a, b);
+            const __m128i evenTags = evensOf4(ta, tb);
+            const __m128i oddTags = oddsOf4(ta, tb);
+            const __m128i firstHigher = _mm_cmpgt_epi32(evens, odds);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(larger + i), _mm_max_epi32(evens, odds));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(smaller + i), _mm_min_epi32(evens, odds));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(largerTags + i), _mm_blendv_epi8(oddTags, evenTags, firstHigher));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(smallerTags + i), _mm_blendv_epi8(evenTags, oddTags, firstHigher));
+        }
+#endif
+        // Branch-free, so the compiler can vectorize it where the above does not apply.
+        for (; i < count; ++i) {
+            const int a = in[2 * i];
+            const int b = in[2 * i + 1];
+            const bool firstHigher = a > b;
+            larger[i] = firstHigher ? a : b;
+            smaller[i] = firstHigher ? b : a;
+            largerTags[i] = firstHigher ? inTags[2 * i] : inTags[2 * i + 1];
+            smallerTags[i] = firstHigher ? inTags[2 * i + 1] : inTags[2 * i];
+        }
+    }
+}
@@ -5,7 +5,14 @@
 #include <iomanip>
 #include <climits>
 #include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include "Benchmark.h"
 #include "FordJohnson.hpp"
+#include "ExternalSort.h"
+#include "IntStream.h"
 
 static bool parsePositiveInt(const char* s, int &out) {
     errno = 0;
@@ -17,11 +24,167 @@ static bool parsePositiveInt(const char* s, int &out) {
     return true;
 }
 
+static void printUsage(const char *name) {
+    std::cerr << "Usage: " << name << " <positive int> [<positive int> ...]" << std::endl;
+    std::cerr << "       " << name << " --input <file|-> [--output <file|->] [--binary]"
+              << " [--memory <MiB>] [--ford-johnson]" << std::endl;
+    std::cerr << "       (--ford-johnson sorts runs of at most " << ExternalSort::MAX_FORD_JOHNSON_RUN
+              << " elements and merges them)" << std::endl;
+    std::cerr << "       " << name << " --bench [--sizes n,...] [--dist random,sorted,reversed,few-unique,organ-pipe]"
+              << " [--trials N] [--warmup N] [--seed S] [--format csv|json] [--output <file>] [--network]"
+              << std::endl;
+}
+
+static bool parseSizeList(const std::string &list, std::vector<size_t> &out) {
+    std::istringstream iss(list);
+    std::string item;
+    out.clear();
+    while (std::getline(iss, item, ',')) {
+        int v;
+        if (!parsePositiveInt(item.c_str(), v)) return false;
+        out.push_back(static_cast<size_t>(v));
+    }
+    return !out.empty();
+}
+
+static bool parseDistributionList(const std::string &list, std::vector<Distribution> &out) {
+    std::istringstream iss(list);
+    std::string item;
+    out.clear();
+    while (std::getline(iss, item, ',')) {
+        Distribution d;
+        if (!Benchmark::parseDistribution(item, d)) return false;
+        out.push_back(d);
+    }
+    return !out.empty();
+}
+
+// Benchmark mode: sweeps sizes and input distributions with warmup and
+// repeated trials, and writes one CSV/JSON record per configuration.
+static int runBenchmark(const int argc, char **argv) {
+    BenchmarkConfig config;
+    config.sizes = {16, 64, 256, 1024, 4096};
+    config.distributions = {
+        Distribution::RANDOM, Distribution::SORTED, Distribution::REVERSED,
+        Distribution::FEW_UNIQUE, Distribution::ORGAN_PIPE
+    };
+    config.warmup = 3;
+    config.trials = 21;
+    config.seed = 42;
+    config.json = false;
+    config.baseCase = BaseCase::MERGE_INSERTION;
+    std::string outputPath = "-";
+
+    for (int i = 2; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        int v = 0;
+        bool ok = hasValue;
+        if (arg == "--sizes" && hasValue) ok = parseSizeList(argv[++i], config.sizes);
+        else if (arg == "--dist" && hasValue) ok = parseDistributionList(argv[++i], config.distributions);
+        else if (arg == "--trials" && hasValue) {
+            ok = parsePositiveInt(argv[++i], v);
+            config.trials = static_cast<size_t>(v);
+        } else if (arg == "--warmup" && hasValue) {
+            const std::string value = argv[++i];
+            ok = value == "0" || parsePositiveInt(value.c_str(), v);
+            config.warmup = value == "0" ? 0 : static_cast<size_t>(v);
+        } else if (arg == "--seed" && hasValue) {
+            ok = parsePositiveInt(argv[++i], v);
+            config.seed = static_cast<unsigned int>(v);
+        } else if (arg == "--format" && hasValue) {
+            const std::string format = argv[++i];
+            ok = format == "csv" || format == "json";
+            config.json = format == "json";
+        } else if (arg == "--network") {
+            ok = true;
+            config.baseCase = BaseCase::SORTING_NETWORK;
+        } else if (arg == "--output" && hasValue) outputPath = argv[++i];
+        else ok = false;
+        if (!ok) {
+            std::cerr << "Error: invalid benchmark argument '" << arg << "'" << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    Benchmark bench(config);
+    if (!bench.run()) return 1;
+    if (outputPath == "-") {
+        bench.write(std::cout);
+        return 0;
+    }
+    std::ofstream out(outputPath);
+    if (!out.is_open()) {
+        std::cerr << "Error: cannot open " << outputPath << std::endl;
+        return 1;
+    }
+    bench.write(out);
+    return 0;
+}
+
+// Stream mode: reads the numbers from a file or stdin instead of argv, so
+// n is not capped by the argument limit, and sorts them externally when
+// they exceed the memory budget. Only a summary goes to stderr.
+static int sortStream(const int argc, char **argv) {
+    std::string inputPath;
+    std::string outputPath = "-";
+    IntFormat format = IntFormat::TEXT;
+    size_t memoryMiB = 256;
+    ExternalSort::Algorithm algorithm = ExternalSort::Algorithm::FAST;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if ((arg == "--input" || arg == "-i") && hasValue) inputPath = argv[++i];
+        else if ((arg == "--output" || arg == "-o") && hasValue) outputPath = argv[++i];
+        else if (arg == "--binary") format = IntFormat::BINARY;
+        else if (arg == "--ford-johnson") algorithm = ExternalSort::Algorithm::FORD_JOHNSON;
+        else if (arg == "--memory" && hasValue) {
+            int v;
+            if (!parsePositiveInt(argv[++i], v)) {
+                std::cerr << "Error: invalid memory budget '" << argv[i] << "'" << std::endl;
+                return 1;
+            }
+            memoryMiB = static_cast<size_t>(v);
+        } else {
+            std::cerr << "Error: unexpected argument '" << arg << "'" << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (inputPath.empty()) {
+        std::cerr << "Error: --input is required in stream mode" << std::endl;
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    try {
+        IntReader in(inputPath, format);
+        IntWriter out(outputPath, format);
+        ExternalSort sorter(memoryMiB << 20, algorithm);
+
+        const auto t0 = std::chrono::steady_clock::now();
+        const size_t n = sorter.sort(in, out);
+        const auto t1 = std::chrono::steady_clock::now();
+        const auto durMs = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
+        std::cerr << "Sorted " << n << " elements in " << sorter.getRunCount() << " run(s): "
+                  << durMs << " ms" << std::endl;
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
 int main(const int argc, char **argv) {
     if (argc < 2) {
         std::cerr << "Error: provide a sequence of positive integers as arguments." << std::endl;
+        printUsage(argv[0]);
         return 1;
     }
+    if (std::strcmp(argv[1], "--bench") == 0) return runBenchmark(argc, argv);
+    if (std::strncmp(argv[1], "--", 2) == 0 || std::strcmp(argv[1], "-i") == 0) return sortStream(argc, argv);
 
     std::vector<int> inputVec; inputVec.reserve(static_cast<size_t>(argc - 1));
     std::deque<int>  inputDeq;